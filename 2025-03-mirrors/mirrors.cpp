@@ -1,12 +1,20 @@
 #include <iostream>
 #include <memory>
 #include <cstdint>
+#include <cstdlib>
 #include <cassert>
 #include <string>
 #include <algorithm>
+#include <bitset>
 #include <sstream>
 #include <functional>
 #include <limits>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
 
 static constexpr int n = 10; // side of field
 
@@ -80,20 +88,57 @@ static Direction opposite_direction(Direction dir)
 	return Direction((dir + 2) % 4);
 }
 
+static bool is_mirror(CellType type)
+{
+	return type == CellType::ForwardMirror || type == CellType::BackwardMirror;
+}
+
+static Direction dir_after_mirror(CellType mirror, Direction dir)
+{
+	assert(is_mirror(mirror));
+	return mirror == CellType::ForwardMirror ? dir_after_forward_mirror[dir] : dir_after_backward_mirror[dir];
+}
+
+// Product of the segment lengths of a laser's path. Hints fit easily in 32 bits, but a long path of a laser without
+// a hint (beams may cross) can have a product beyond 64 bits even on a 10x10 board. Such products saturate to
+// overflowed_product, which never matches a hint, and a solution that needs one is reported as not computable.
+using LaserProduct = uint64_t;
+
+static constexpr LaserProduct overflowed_product = std::numeric_limits<LaserProduct>::max();
+
+static LaserProduct saturating_mul(LaserProduct product, LaserProduct factor)
+{
+	LaserProduct result;
+	if (__builtin_mul_overflow(product, factor, &result))
+		return overflowed_product;
+	return result;
+}
+
+static std::string to_string(unsigned __int128 value)
+{
+	std::string result;
+	do
+	{
+		result.push_back(char('0' + int(value % 10)));
+		value /= 10;
+	} while (value);
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
 class Board
 {
 public:
 	Board():
 		cells(new CellType[n * n]{}),
-		lasers(new unsigned int[4 * n]{}),
+		lasers(new LaserProduct[4 * n]{}),
 		laser_has_path(new bool[4 * n]{})
 	{
-		std::cout << "Created board with side " << n << std::endl;
 	}
 
 	Board(Board const & other):
 		cells(new CellType[n * n]),
-		lasers(new unsigned int[4 * n]),
+		lasers(new LaserProduct[4 * n]),
 		laser_has_path(new bool[4 * n])
 	{
 		std::copy(&other.cells[0], &other.cells[n * n], &this->cells[0]);
@@ -123,12 +168,12 @@ public:
 		return cell(pos.row, pos.col);
 	}
 
-	unsigned int * get_lasers()
+	LaserProduct * get_lasers()
 	{
 		return lasers.get();
 	}
 
-	unsigned int const * get_lasers() const
+	LaserProduct const * get_lasers() const
 	{
 		return lasers.get();
 	}
@@ -205,26 +250,26 @@ public:
 		assert(false);
 	}
 
-	unsigned int & laser(int row, int col)
+	LaserProduct & laser(int row, int col)
 	{
 		auto [laser_section_idx, laser_offset] = get_laser_section_and_offset(row, col);
 		int const laser_idx = laser_section_idx * n + laser_offset;
 		return lasers[laser_idx];
 	}
 
-	unsigned int laser(int row, int col) const
+	LaserProduct laser(int row, int col) const
 	{
 		auto [laser_section_idx, laser_offset] = get_laser_section_and_offset(row, col);
 		int const laser_idx = laser_section_idx * n + laser_offset;
 		return lasers[laser_idx];
 	}
 
-	unsigned int & laser(Pos const & pos)
+	LaserProduct & laser(Pos const & pos)
 	{
 		return laser(pos.row, pos.col);
 	}
 
-	unsigned int laser(Pos const & pos) const
+	LaserProduct laser(Pos const & pos) const
 	{
 		return laser(pos.row, pos.col);
 	}
@@ -241,7 +286,7 @@ private:
 	// right: col==n, row in [0; n-1]
 	// bottom: row==n, col in [0; n-1]
 	// left: col==-1, row in [0; n-1]
-	std::unique_ptr<unsigned int[]> lasers;
+	std::unique_ptr<LaserProduct[]> lasers;
 
 	// 4 * n numbers, one per laser
 	std::unique_ptr<bool[]> laser_has_path;
@@ -398,12 +443,21 @@ class LaserPathsVisitor
 public:
 	// When called, a full path from start to some other laser is applied. The end laser has its number updated.
 	// return value: true if visiting should be continued
-	using Callback = std::function<bool(unsigned int path_product)>;
+	using Callback = std::function<bool(LaserProduct path_product)>;
+
+	// Which lasers a path may end at.
+	enum class EndLasers
+	{
+		Any,
+		WithoutHint
+	};
 
-	LaserPathsVisitor(Board & board, int start_laser_section_idx, int start_laser_offset, Callback const & callback):
+	LaserPathsVisitor(Board & board, int start_laser_section_idx, int start_laser_offset, Callback const & callback,
+			EndLasers end_lasers = EndLasers::Any):
 		board(board),
 		callback(callback),
-		start_pos(board.laser_section_and_offset_to_pos(start_laser_section_idx, start_laser_offset))
+		start_pos(board.laser_section_and_offset_to_pos(start_laser_section_idx, start_laser_offset)),
+		end_lasers(end_lasers)
 	{
 		Direction const start_dir = opposite_direction(Direction(start_laser_section_idx));
 
@@ -419,7 +473,7 @@ public:
 private:
 	// path_product: product of segment lengths already on path
 	// needed_product: if non-zero then remaining segments' product must be equal to it
-	bool rec_visit(Pos const cur_pos, Direction const cur_dir, unsigned int path_product, unsigned int needed_product)
+	bool rec_visit(Pos const cur_pos, Direction const cur_dir, LaserProduct path_product, LaserProduct needed_product)
 	{
 		// try increasing segment lengths, until we hit a laser or a mirror
 		bool cont = true;
@@ -461,21 +515,25 @@ private:
 				bool visit_more = true;
 				do // fake loop for visit_more (in case we need a break)
 				{
-					unsigned int new_needed_product = needed_product / segment_length;
-					unsigned int new_path_product = path_product * segment_length;
+					LaserProduct const new_needed_product = needed_product / segment_length;
+					// With a known needed_product the path product is bounded by it, only an unknown one can overflow.
+					LaserProduct const new_path_product = needed_product
+						? path_product * segment_length
+						: saturating_mul(path_product, segment_length);
 					if (!board.is_on_board(end_pos))
 					{
 						// end_pos is a laser
 						auto [end_laser_section_idx, end_laser_offset] = board.get_laser_section_and_offset(end_pos);
 						int const end_laser_idx = end_laser_section_idx * n + end_laser_offset;
 
-						unsigned int const end_laser_num = board.get_lasers()[end_laser_idx];
-						if (new_needed_product <= 1 && (end_laser_num == 0 || end_laser_num == new_path_product))
+						LaserProduct const end_laser_num = board.get_lasers()[end_laser_idx];
+						if (new_needed_product <= 1 && (end_laser_num == 0
+									|| (end_lasers == EndLasers::Any && end_laser_num == new_path_product)))
 						{
 							board.get_lasers()[end_laser_idx] = new_path_product;
 							assert(!board.get_laser_has_path()[end_laser_idx]);
 							board.get_laser_has_path()[end_laser_idx] = true;
-							unsigned int const start_laser_num = board.laser(start_pos);
+							LaserProduct const start_laser_num = board.laser(start_pos);
 							board.laser(start_pos) = new_path_product;
 
 							visit_more = callback(new_path_product);
@@ -549,6 +607,327 @@ private:
 	Board & board;
 	Callback const callback;
 	Pos const start_pos;
+	EndLasers const end_lasers;
+};
+
+/*
+ * Visits paths between two lasers that both have the same hint (and no path yet), using a meet-in-the-middle search.
+ *
+ * A path with segment lengths s_1, ..., s_m and product h is split at the first segment j for which
+ * (s_1 * ... * s_j)^2 > h (or j = m if there is none, which only happens for h == 1). Half-paths grown from the end
+ * laser (segments m, m-1, ..., j+1) are recorded first; they have product below sqrt(h). Then half-paths grown from the
+ * start laser (segments 1, ..., j-1, product at most sqrt(h)) are joined with recorded ones by the bridging segment j,
+ * so every path is visited exactly once. Both halves are only pruned by the board as it is before the other half is
+ * applied, so a join is verified by walking the rest of the path over the board with the start half already applied.
+ */
+class LaserPairPathsVisitor
+{
+public:
+	// When called, a full path from start to end laser is applied.
+	// return value: true if visiting should be continued
+	using Callback = LaserPathsVisitor::Callback;
+
+	// The visitor is reused for many pairs of lasers (see init()), so that its buffers are allocated only once.
+	LaserPairPathsVisitor(Board & board, int max_half_paths):
+		board(board),
+		callback(nullptr),
+		start_laser_section_idx(0),
+		start_laser_offset(0),
+		end_laser_section_idx(0),
+		end_laser_offset(0),
+		start_pos(),
+		end_pos(),
+		hint(0),
+		max_half_paths(max_half_paths),
+		half_paths(),
+		half_path_mirrors(),
+		half_paths_at(),
+		mirrors_stack(),
+		usable(false)
+	{
+		std::fill(std::begin(half_paths_at), std::end(half_paths_at), -1);
+	}
+
+	// Grows half-paths from the end laser, callback must outlive run(). If there are more than max_half_paths of them,
+	// the bidirectional search is not worth it: growing stops and is_usable() returns false.
+	void init(int start_laser_section_idx, int start_laser_offset, int end_laser_section_idx, int end_laser_offset,
+			Callback const & callback)
+	{
+		// only the entries of recorded half-paths were changed
+		for (HalfPath const & half_path : half_paths)
+			half_paths_at[half_path.key] = -1;
+		half_paths.clear();
+		half_path_mirrors.clear();
+		assert(mirrors_stack.empty());
+
+		this->callback = &callback;
+		this->start_laser_section_idx = start_laser_section_idx;
+		this->start_laser_offset = start_laser_offset;
+		this->end_laser_section_idx = end_laser_section_idx;
+		this->end_laser_offset = end_laser_offset;
+		start_pos = board.laser_section_and_offset_to_pos(start_laser_section_idx, start_laser_offset);
+		end_pos = board.laser_section_and_offset_to_pos(end_laser_section_idx, end_laser_offset);
+		hint = board.laser(start_pos);
+		assert(hint != 0 && board.laser(end_pos) == hint);
+		usable = grow_end_half(end_pos, opposite_direction(Direction(end_laser_section_idx)), 1);
+	}
+
+	bool is_usable() const
+	{
+		return usable;
+	}
+
+	// return value: true if visiting should be continued
+	bool run()
+	{
+		assert(usable);
+		int const start_laser_idx = start_laser_section_idx * n + start_laser_offset;
+		int const end_laser_idx = end_laser_section_idx * n + end_laser_offset;
+		assert(!board.get_laser_has_path()[start_laser_idx]);
+		assert(!board.get_laser_has_path()[end_laser_idx]);
+
+		board.get_laser_has_path()[start_laser_idx] = true;
+		board.get_laser_has_path()[end_laser_idx] = true;
+		bool const visit_more = grow_start_half(start_pos, opposite_direction(Direction(start_laser_section_idx)), 1);
+		board.get_laser_has_path()[end_laser_idx] = false;
+		board.get_laser_has_path()[start_laser_idx] = false;
+		return visit_more;
+	}
+
+private:
+	struct Mirror
+	{
+		Pos pos;
+		CellType type;
+	};
+
+	// Mirrors of a half-path grown from the end laser are half_path_mirrors[first_mirror .. first_mirror + num_mirrors),
+	// starting from the one closest to the end laser.
+	struct HalfPath
+	{
+		LaserProduct product;
+		int first_mirror;
+		int num_mirrors;
+		int key; // half_path_key() of the end of the half-path
+		int next_at_key; // index of next half-path with the same half_path_key() or -1
+	};
+
+	// pos is either on board or a laser, dir is the direction in which the beam leaves pos
+	static int half_path_key(Pos const pos, Direction const dir)
+	{
+		return ((pos.row + 1) * (n + 2) + (pos.col + 1)) * 4 + dir;
+	}
+
+	// Same rules as in LaserPathsVisitor::rec_visit().
+	bool can_place_mirror(Pos const pos, CellType mirror) const
+	{
+		CellType const type = board.cell(pos);
+		if (type == CellType::LaserBeam || (type != CellType::Empty && type != mirror))
+			return false;
+		for (Pos const dir : all_dirs)
+		{
+			Pos const neighbor = pos + dir;
+			if (board.is_on_board(neighbor) && is_mirror(board.cell(neighbor)))
+				return false;
+		}
+		return true;
+	}
+
+	// Marks cells strictly between from and from + dir * length with LaserBeam. Returns false (leaving the board
+	// partially marked) if there is a mirror on the way.
+	bool mark_segment(Pos const from, Direction const dir, int length)
+	{
+		for (int i = 1; i < length; ++i)
+		{
+			Pos const pos = from + direction_to_vec[dir] * i;
+			if (is_mirror(board.cell(pos)))
+				return false;
+			board.cell(pos) = CellType::LaserBeam;
+		}
+		return true;
+	}
+
+	void save_cells(CellType (&saved)[n * n]) const
+	{
+		for (int row = 0; row < n; ++row)
+			for (int col = 0; col < n; ++col)
+				saved[row * n + col] = board.cell(row, col);
+	}
+
+	void restore_cells(CellType const (&saved)[n * n])
+	{
+		for (int row = 0; row < n; ++row)
+			for (int col = 0; col < n; ++col)
+				board.cell(row, col) = saved[row * n + col];
+	}
+
+	// Grows half-paths from the end laser, recording each with product below sqrt(hint) (and the empty one).
+	// return value: false if there are too many half-paths
+	bool grow_end_half(Pos const cur_pos, Direction const cur_dir, LaserProduct product)
+	{
+		if ((int)half_paths.size() >= max_half_paths)
+			return false;
+		int const key = half_path_key(cur_pos, cur_dir);
+		int & first_at_key = half_paths_at[key];
+		half_paths.push_back({product, (int)half_path_mirrors.size(), (int)mirrors_stack.size(), key, first_at_key});
+		first_at_key = (int)half_paths.size() - 1;
+		half_path_mirrors.insert(half_path_mirrors.end(), mirrors_stack.begin(), mirrors_stack.end());
+
+		for (int segment_length = 1; ; ++segment_length)
+		{
+			Pos const mirror_pos = cur_pos + direction_to_vec[cur_dir] * segment_length;
+			if (!board.is_on_board(mirror_pos))
+				break;
+
+			LaserProduct const new_product = product * segment_length;
+			// stop when even the shortest segment makes the half too long
+			if (new_product > (hint - 1) / new_product)
+				break;
+
+			if (hint % new_product == 0)
+			{
+				bool is_ok = true;
+				try_mirrors(cur_pos, cur_dir, segment_length, [&](Direction new_dir)
+				{
+					if (is_ok)
+						is_ok = grow_end_half(mirror_pos, new_dir, new_product);
+				});
+				if (!is_ok)
+					return false;
+			}
+
+			if (is_mirror(board.cell(mirror_pos)))
+				break;
+		}
+		return true;
+	}
+
+	// Grows half-paths from the start laser (product at most sqrt(hint)) and joins them with recorded ones.
+	bool grow_start_half(Pos const cur_pos, Direction const cur_dir, LaserProduct product)
+	{
+		for (int segment_length = 1; ; ++segment_length)
+		{
+			Pos const next_pos = cur_pos + direction_to_vec[cur_dir] * segment_length;
+			LaserProduct const new_product = product * segment_length;
+			bool const is_last = !board.is_on_board(next_pos) || is_mirror(board.cell(next_pos));
+
+			if (hint % new_product == 0)
+			{
+				// try segment_length as the bridging segment
+				if (new_product > hint / new_product || hint == 1)
+				{
+					LaserProduct const end_half_product = hint / new_product;
+					for (int half_path_idx = half_paths_at[half_path_key(next_pos, opposite_direction(cur_dir))];
+							half_path_idx >= 0; half_path_idx = half_paths[half_path_idx].next_at_key)
+					{
+						HalfPath const & half_path = half_paths[half_path_idx];
+						if (half_path.product != end_half_product || (hint == 1 && half_path.num_mirrors > 0))
+							continue;
+						if (!join(cur_pos, cur_dir, segment_length, half_path))
+							return false;
+					}
+				}
+
+				// try segment_length as a segment of the start half
+				if (board.is_on_board(next_pos) && new_product <= hint / new_product)
+				{
+					bool visit_more = true;
+					try_mirrors(cur_pos, cur_dir, segment_length, [&](Direction new_dir)
+					{
+						if (visit_more)
+							visit_more = grow_start_half(next_pos, new_dir, new_product);
+					});
+					if (!visit_more)
+						return false;
+				}
+			}
+
+			if (is_last)
+				break;
+		}
+		return true;
+	}
+
+	// Marks the segment from cur_pos with LaserBeam and calls fun(new_dir) for each mirror that can be placed at its
+	// end, with that mirror placed. Board is restored afterwards.
+	template<typename Fun>
+	void try_mirrors(Pos const cur_pos, Direction const cur_dir, int segment_length, Fun const & fun)
+	{
+		Pos const mirror_pos = cur_pos + direction_to_vec[cur_dir] * segment_length;
+		CellType saved[n * n];
+		save_cells(saved);
+		if (mark_segment(cur_pos, cur_dir, segment_length))
+		{
+			CellType const orig_type = board.cell(mirror_pos);
+			for (CellType new_mirror : {CellType::ForwardMirror, CellType::BackwardMirror})
+			{
+				if (can_place_mirror(mirror_pos, new_mirror))
+				{
+					board.cell(mirror_pos) = new_mirror;
+					mirrors_stack.push_back({mirror_pos, new_mirror});
+					fun(dir_after_mirror(new_mirror, cur_dir));
+					mirrors_stack.pop_back();
+					board.cell(mirror_pos) = orig_type;
+				}
+			}
+		}
+		restore_cells(saved);
+	}
+
+	// The start half is applied and ends at cur_pos with beam going in cur_dir. Walks the bridging segment and the end
+	// half backwards, applying them, and calls back if the whole path is valid.
+	// return value: true if visiting should be continued
+	bool join(Pos const cur_pos, Direction const cur_dir, int bridge_length, HalfPath const & half_path)
+	{
+		CellType saved[n * n];
+		save_cells(saved);
+
+		bool is_ok = mark_segment(cur_pos, cur_dir, bridge_length);
+		Pos pos = cur_pos + direction_to_vec[cur_dir] * bridge_length;
+		Direction dir = cur_dir;
+		for (int i = half_path.num_mirrors - 1; is_ok && i >= 0; --i)
+		{
+			Mirror const & mirror = half_path_mirrors[half_path.first_mirror + i];
+			assert(mirror.pos.row == pos.row && mirror.pos.col == pos.col);
+			is_ok = can_place_mirror(pos, mirror.type);
+			if (is_ok)
+			{
+				board.cell(pos) = mirror.type;
+				dir = dir_after_mirror(mirror.type, dir);
+				Pos const next_pos = i > 0 ? half_path_mirrors[half_path.first_mirror + i - 1].pos : end_pos;
+				int const length = std::abs(next_pos.row - pos.row) + std::abs(next_pos.col - pos.col);
+				is_ok = mark_segment(pos, dir, length);
+				pos = next_pos;
+			}
+		}
+
+		bool visit_more = true;
+		if (is_ok)
+		{
+			assert(pos.row == end_pos.row && pos.col == end_pos.col);
+			visit_more = (*callback)(hint);
+		}
+
+		restore_cells(saved);
+		return visit_more;
+	}
+
+	Board & board;
+	Callback const * callback;
+	int start_laser_section_idx;
+	int start_laser_offset;
+	int end_laser_section_idx;
+	int end_laser_offset;
+	Pos start_pos;
+	Pos end_pos;
+	LaserProduct hint;
+	int const max_half_paths;
+
+	std::vector<HalfPath> half_paths;
+	std::vector<Mirror> half_path_mirrors;
+	int half_paths_at[4 * (n + 2) * (n + 2)]; // by half_path_key(): index of the last recorded half-path there or -1
+	std::vector<Mirror> mirrors_stack; // mirrors of the half-path being grown from the end laser
+	bool usable;
 };
 
 class MirrorsSolver
@@ -558,14 +937,24 @@ public:
 
 	MirrorsSolver(Board const & board, Callback const & callback):
 		board(board),
-		callback(callback)
+		callback(callback),
+		pair_visitors(),
+		num_busy_pair_visitors(0),
+		num_nodes(0)
 	{
 		rec_solve();
 	}
 
+	// number of rec_solve() calls
+	uint64_t get_num_nodes() const
+	{
+		return num_nodes;
+	}
+
 private:
 	void rec_solve()
 	{
+		++num_nodes;
 		unsigned int min_count_possible_paths = std::numeric_limits<unsigned int>::max();
 		int best_laser_section_idx, best_laser_offset;
 
@@ -581,8 +970,8 @@ private:
 					if (!board.get_laser_has_path()[laser_idx] && hint_non_zero == !!board.get_lasers()[laser_idx])
 					{
 						unsigned int count = 0;
-						LaserPathsVisitor visitor(board, laser_section_idx, laser_offset,
-								[&](unsigned int /*path_product*/)
+						visit_laser_paths(laser_section_idx, laser_offset,
+								[&](LaserProduct /*path_product*/)
 								{
 									++count;
 									return count < min_count_possible_paths;
@@ -606,8 +995,8 @@ private:
 		else
 		{
 			// Recursively try all paths from the selected laser (with the lowest count of possible paths).
-			LaserPathsVisitor visitor(board, best_laser_section_idx, best_laser_offset,
-					[this](unsigned int /*path_product*/)
+			visit_laser_paths(best_laser_section_idx, best_laser_offset,
+					[this](LaserProduct /*path_product*/)
 					{
 						rec_solve();
 						return true;
@@ -615,84 +1004,527 @@ private:
 		}
 	}
 
+	// Visits all paths from the laser. Paths of a laser with a hint that end at a laser with the same hint are
+	// visited by a bidirectional LaserPairPathsVisitor, the other ones can only end at a laser without a hint.
+	void visit_laser_paths(int laser_section_idx, int laser_offset, LaserPathsVisitor::Callback const & callback)
+	{
+		int const laser_idx = laser_section_idx * n + laser_offset;
+		LaserProduct const hint = board.get_lasers()[laser_idx];
+		if (hint == 0)
+		{
+			LaserPathsVisitor visitor(board, laser_section_idx, laser_offset, callback);
+			return;
+		}
+
+		auto const is_pair_end = [&](int end_laser_idx)
+		{
+			return end_laser_idx != laser_idx && !board.get_laser_has_path()[end_laser_idx]
+				&& board.get_lasers()[end_laser_idx] == hint;
+		};
+		bool found_pair_end = false;
+		for (int end_laser_idx = 0; end_laser_idx < 4 * n; ++end_laser_idx)
+			found_pair_end |= is_pair_end(end_laser_idx);
+		if (!found_pair_end)
+		{
+			LaserPathsVisitor visitor(board, laser_section_idx, laser_offset, callback);
+			return;
+		}
+
+		// Visitors of this call are pair_visitors[first_pair_visitor .. num_busy_pair_visitors), the ones after them
+		// are free for nested calls made from the callback.
+		int const first_pair_visitor = num_busy_pair_visitors;
+		for (int end_laser_idx = 0; end_laser_idx < 4 * n; ++end_laser_idx)
+		{
+			if (is_pair_end(end_laser_idx))
+			{
+				if (num_busy_pair_visitors == (int)pair_visitors.size())
+					pair_visitors.emplace_back(new LaserPairPathsVisitor(board, max_half_paths));
+				LaserPairPathsVisitor & pair_visitor = *pair_visitors[num_busy_pair_visitors++];
+				pair_visitor.init(laser_section_idx, laser_offset, end_laser_idx / n, end_laser_idx % n, callback);
+				if (!pair_visitor.is_usable())
+				{
+					num_busy_pair_visitors = first_pair_visitor;
+					// fall back to one-sided search to all lasers
+					LaserPathsVisitor visitor(board, laser_section_idx, laser_offset, callback);
+					return;
+				}
+			}
+		}
+
+		bool visit_more = true;
+		bool found_end_without_hint = false;
+		for (int end_laser_idx = 0; end_laser_idx < 4 * n; ++end_laser_idx)
+			found_end_without_hint |= !board.get_laser_has_path()[end_laser_idx] && board.get_lasers()[end_laser_idx] == 0;
+		if (found_end_without_hint)
+		{
+			LaserPathsVisitor visitor(board, laser_section_idx, laser_offset,
+					[&](LaserProduct path_product)
+					{
+						visit_more = callback(path_product);
+						return visit_more;
+					},
+					LaserPathsVisitor::EndLasers::WithoutHint);
+		}
+
+		for (int idx = first_pair_visitor; idx < num_busy_pair_visitors && visit_more; ++idx)
+			visit_more = pair_visitors[idx]->run();
+		num_busy_pair_visitors = first_pair_visitor;
+	}
+
+	// Bidirectional search is used only while it is cheap to grow the half-paths from the end laser.
+	static constexpr int max_half_paths = 256;
+
 	Board board;
 	Callback const callback;
+	// Visitors reused by visit_laser_paths(), nested calls use the ones after those busy in the calls below them.
+	std::vector<std::unique_ptr<LaserPairPathsVisitor>> pair_visitors;
+	int num_busy_pair_visitors;
+	uint64_t num_nodes;
 };
 
-void print_answer(Board const & orig_board, Board const & solved_board)
+/*
+ * Alternative to MirrorsSolver, which branches on a single cell at a time (empty, forward or backward mirror) instead of
+ * on a whole laser path. Before each decision, beams of all lasers are traced over the decided cells up to the first
+ * undecided one, and products of their finished segments are checked against the hints. The next cell to decide is the
+ * end of such a partial beam, preferably of a laser with a hint and the smallest remaining product. When no beam ends
+ * at an undecided cell, the remaining cells are not reachable by any laser, so they are empty (as in MirrorsSolver,
+ * which only puts mirrors on laser paths).
+ */
+class CellsSolver
 {
-	std::cout << "\nFound solution:\n" << solved_board << std::flush;
+public:
+	using Callback = MirrorsSolver::Callback;
 
-	unsigned long long prod = 1;
+	CellsSolver(Board const & board, Callback const & callback):
+		board(board),
+		callback(callback),
+		decided(),
+		num_nodes(0)
+	{
+		rec_solve();
+	}
+
+	// number of rec_solve() calls
+	uint64_t get_num_nodes() const
+	{
+		return num_nodes;
+	}
+
+private:
+	void rec_solve()
+	{
+		++num_nodes;
+		Pos branch_pos;
+		if (!trace_lasers(branch_pos))
+			return;
+
+		if (branch_pos.row < 0)
+		{
+			// All beams leave the board.
+			report_solution();
+			return;
+		}
+
+		assert(!decided[branch_pos.row * n + branch_pos.col]);
+		assert(board.cell(branch_pos) == CellType::Empty);
+		decided[branch_pos.row * n + branch_pos.col] = true;
+		for (CellType cell : {CellType::Empty, CellType::ForwardMirror, CellType::BackwardMirror})
+		{
+			if (cell != CellType::Empty && has_adjacent_mirror(branch_pos))
+				break;
+			board.cell(branch_pos) = cell;
+			rec_solve();
+		}
+		board.cell(branch_pos) = CellType::Empty;
+		decided[branch_pos.row * n + branch_pos.col] = false;
+	}
+
+	// Traces beams of all lasers over decided cells.
+	// return value: false if some hint cannot be satisfied anymore, otherwise branch_pos is set to the undecided cell
+	// to branch on, or to {-1, -1} if there is none
+	bool trace_lasers(Pos & branch_pos) const
+	{
+		branch_pos = {-1, -1};
+		LaserProduct best_remaining_product = std::numeric_limits<LaserProduct>::max();
+		for (int laser_section_idx = 0; laser_section_idx < 4; ++laser_section_idx)
+		{
+			for (int laser_offset = 0; laser_offset < n; ++laser_offset)
+			{
+				LaserProduct const hint = board.get_lasers()[laser_section_idx * n + laser_offset];
+				Pos pos = board.laser_section_and_offset_to_pos(laser_section_idx, laser_offset);
+				Direction dir = opposite_direction(Direction(laser_section_idx));
+				LaserProduct product = 1; // product of finished segments
+				for (int segment_length = 1; ; ++segment_length)
+				{
+					pos = pos + direction_to_vec[dir];
+					if (!board.is_on_board(pos))
+					{
+						// beam reached the other laser
+						if (hint && saturating_mul(product, segment_length) != hint)
+							return false;
+						break;
+					}
+
+					if (!decided[pos.row * n + pos.col])
+					{
+						// beam reached an undecided cell, its segment is at least segment_length long
+						LaserProduct remaining_product = std::numeric_limits<LaserProduct>::max();
+						if (hint)
+						{
+							remaining_product = hint / product;
+							if (remaining_product < (LaserProduct)segment_length)
+								return false;
+						}
+						if (branch_pos.row < 0 || remaining_product < best_remaining_product)
+						{
+							best_remaining_product = remaining_product;
+							branch_pos = pos;
+						}
+						break;
+					}
+
+					CellType const cell = board.cell(pos);
+					if (is_mirror(cell))
+					{
+						product = saturating_mul(product, segment_length);
+						if (hint && hint % product != 0)
+							return false;
+						dir = dir_after_mirror(cell, dir);
+						segment_length = 0;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	bool has_adjacent_mirror(Pos const pos) const
+	{
+		for (Pos const dir : all_dirs)
+		{
+			Pos const neighbor = pos + dir;
+			if (board.is_on_board(neighbor) && is_mirror(board.cell(neighbor)))
+				return true;
+		}
+		return false;
+	}
+
+	// Calls back with a board in the same form as MirrorsSolver does: beams marked with LaserBeam, each laser has a path
+	// and its number set.
+	void report_solution()
+	{
+		Board solved_board(board);
+		for (int laser_idx = 0; laser_idx < 4 * n; ++laser_idx)
+		{
+			Pos pos = board.laser_section_and_offset_to_pos(laser_idx / n, laser_idx % n);
+			Direction dir = opposite_direction(Direction(laser_idx / n));
+			LaserProduct product = 1;
+			for (int segment_length = 1; ; ++segment_length)
+			{
+				pos = pos + direction_to_vec[dir];
+				if (!board.is_on_board(pos))
+				{
+					product = saturating_mul(product, segment_length);
+					break;
+				}
+				CellType const cell = board.cell(pos);
+				if (is_mirror(cell))
+				{
+					product = saturating_mul(product, segment_length);
+					dir = dir_after_mirror(cell, dir);
+					segment_length = 0;
+				}
+				else
+				{
+					solved_board.cell(pos) = CellType::LaserBeam;
+				}
+			}
+			solved_board.get_lasers()[laser_idx] = product;
+			solved_board.get_laser_has_path()[laser_idx] = true;
+		}
+		callback(solved_board);
+	}
+
+	Board board; // undecided cells are Empty
+	Callback const callback;
+	std::bitset<n * n> decided;
+	uint64_t num_nodes;
+};
+
+// Computes the final answer: product of side sums, counting only lasers without a hint on orig_board.
+// return value: false if it does not fit (side sums must fit in 64 bits, their product gets 128 bits)
+bool compute_answer(Board const & orig_board, Board const & solved_board, LaserProduct (&side_sums)[4],
+		unsigned __int128 & answer)
+{
+	answer = 1;
+	bool overflow = false;
 	for (int laser_section_idx = 0; laser_section_idx < 4; ++laser_section_idx)
 	{
-		unsigned int sum = 0;
+		LaserProduct & sum = side_sums[laser_section_idx];
+		sum = 0;
 		for (int laser_offset = 0; laser_offset < n; ++laser_offset)
 		{
 			int const laser_idx = laser_section_idx * n + laser_offset;
 			if (orig_board.get_lasers()[laser_idx] == 0)
 			{
-				sum += solved_board.get_lasers()[laser_idx];
+				LaserProduct const laser_num = solved_board.get_lasers()[laser_idx];
+				overflow |= laser_num == overflowed_product;
+				overflow |= __builtin_add_overflow(sum, laser_num, &sum);
 			}
 		}
-		std::cout << "side sum: " << sum << '\n';
-		prod *= sum;
+		overflow |= __builtin_mul_overflow(answer, (unsigned __int128)sum, &answer);
 	}
+	return !overflow;
+}
+
+void print_answer(Board const & orig_board, Board const & solved_board)
+{
+	std::cout << "\nFound solution:\n" << solved_board << std::flush;
 
-	std::cout << "final answer: " << prod << std::endl;
+	LaserProduct side_sums[4];
+	unsigned __int128 answer;
+	if (compute_answer(orig_board, solved_board, side_sums, answer))
+	{
+		for (LaserProduct const sum : side_sums)
+			std::cout << "side sum: " << sum << '\n';
+		std::cout << "final answer: " << to_string(answer) << std::endl;
+	}
+	else
+	{
+		std::cout << "final answer: overflow, laser numbers are too big" << std::endl;
+	}
 }
 
-int main()
+// Reads n numbers of lasers in given section.
+void read_lasers(std::istream & inp, Board & board, Direction laser_section_idx)
 {
-	std::cout << "Enter n: ";
-	int n_;
-	std::cin >> n_;
-	if (n_ != n)
+	for (int laser_offset = 0; laser_offset < n; ++laser_offset)
 	{
-		std::cerr << "program was compiled for n=" << n << '\n';
-		return 1;
+		int const laser_idx = laser_section_idx * n + laser_offset;
+		inp >> board.get_lasers()[laser_idx];
 	}
+}
 
-	Board board;
+// Solves board with selected engine, calling back for each solution.
+// return value: number of search nodes
+uint64_t solve(Board const & board, bool use_cells_solver, MirrorsSolver::Callback const & callback)
+{
+	if (use_cells_solver)
+		return CellsSolver(board, callback).get_num_nodes();
+	else
+		return MirrorsSolver(board, callback).get_num_nodes();
+}
 
-	// go over top lasers
-	std::cout << "Enter numbers of top lasers: ";
-	for (int col = 0; col < n; ++col)
+/*
+ * A fixed number of threads executing tasks in order of submission.
+ */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	explicit ThreadPool(int num_threads):
+		mutex(),
+		cond(),
+		tasks(),
+		stopping(false),
+		threads()
 	{
-		int const laser_idx = UpDir * n + col;
-		std::cin >> board.get_lasers()[laser_idx];
+		for (int i = 0; i < num_threads; ++i)
+			threads.emplace_back(&ThreadPool::work, this);
 	}
 
-	// go over right lasers
-	std::cout << "Enter numbers of right lasers: ";
-	for (int row = 0; row < n; ++row)
+	// It waits for all submitted tasks to finish.
+	~ThreadPool()
 	{
-		int const laser_idx = RightDir * n + row;
-		std::cin >> board.get_lasers()[laser_idx];
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		cond.notify_all();
+		for (std::thread & thread : threads)
+			thread.join();
 	}
 
-	// go over bottom lasers
-	std::cout << "Enter numbers of bottom lasers: ";
-	for (int col = 0; col < n; ++col)
+	void submit(Task task)
 	{
-		int const laser_idx = DownDir * n + col;
-		std::cin >> board.get_lasers()[laser_idx];
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push(std::move(task));
+		}
+		cond.notify_one();
 	}
 
-	// go over left lasers
-	std::cout << "Enter numbers of left lasers: ";
-	for (int row = 0; row < n; ++row)
+private:
+	void work()
 	{
-		int const laser_idx = LeftDir * n + row;
-		std::cin >> board.get_lasers()[laser_idx];
+		while (true)
+		{
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cond.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (tasks.empty())
+					return; // stopping
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
 	}
 
-	std::cout << "Board:\n" << board;
-	std::cout << "Solving..." << std::endl;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::queue<Task> tasks;
+	bool stopping;
+	std::vector<std::thread> threads;
+};
+
+/*
+ * Batch mode: reads a stream of boards, each one preceded by "board <id>" and then given in the same format as in the
+ * interactive mode (n and numbers of top, right, bottom, left lasers). Boards are solved concurrently, and for each one
+ * a single line is printed when it is done (so in completion order):
+ * <id> answer=<answer> solutions=<count> time_ms=<time> nodes=<count>
+ * where answer is the final answer of the first solution found, or "none". A board of other size than n is skipped
+ * with a line "<id> error=<message>", and the rest of the stream is still solved.
+ * return value: exit code, 1 if any board was skipped or the stream could not be read
+ */
+int run_batch(std::istream & inp, int num_threads, bool use_cells_solver)
+{
+	std::mutex out_mutex;
+	ThreadPool pool(num_threads);
+	int result = 0;
+
+	std::string keyword;
+	while (inp >> keyword)
+	{
+		std::string id;
+		int n_;
+		if (keyword != "board" || !(inp >> id >> n_))
+		{
+			std::cerr << "expected: board <id> <n>\n";
+			return 1;
+		}
+		if (n_ != n)
+		{
+			// skip numbers of lasers of the board
+			LaserProduct laser;
+			for (int i = 0; i < 4 * n_ && inp >> laser; ++i)
+			{
+			}
+			if (n_ <= 0 || !inp)
+			{
+				std::cerr << "board " << id << ": cannot read numbers of lasers\n";
+				return 1;
+			}
+			std::lock_guard<std::mutex> lock(out_mutex);
+			std::cout << id << " error=program was compiled for n=" << n << std::endl;
+			result = 1;
+			continue;
+		}
+
+		std::shared_ptr<Board> board(new Board());
+		for (Direction laser_section_idx : {UpDir, RightDir, DownDir, LeftDir})
+			read_lasers(inp, *board, laser_section_idx);
+		if (!inp)
+		{
+			std::cerr << "board " << id << ": cannot read numbers of lasers\n";
+			return 1;
+		}
 
-	MirrorsSolver solver(board,
-			[&](Board const & solved_board)
+		pool.submit([board, id, use_cells_solver, &out_mutex]()
+		{
+			auto const start_time = std::chrono::steady_clock::now();
+
+			uint64_t num_solutions = 0;
+			std::string answer_str = "none";
+			uint64_t const num_nodes = solve(*board, use_cells_solver, [&](Board const & solved_board)
 			{
-				print_answer(board, solved_board);
+				if (num_solutions++ == 0)
+				{
+					LaserProduct side_sums[4];
+					unsigned __int128 answer;
+					answer_str = compute_answer(*board, solved_board, side_sums, answer)
+						? to_string(answer)
+						: "overflow";
+				}
 			});
+
+			auto const time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - start_time).count();
+
+			std::lock_guard<std::mutex> lock(out_mutex);
+			std::cout << id
+				<< " answer=" << answer_str
+				<< " solutions=" << num_solutions
+				<< " time_ms=" << time_ms
+				<< " nodes=" << num_nodes
+				<< std::endl;
+		});
+	}
+	return result;
+}
+
+int main(int argc, char * argv[])
+{
+	bool use_cells_solver = false;
+	bool batch = false;
+	int num_threads = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "--engine=paths")
+		{
+			use_cells_solver = false;
+		}
+		else if (arg == "--engine=cells")
+		{
+			use_cells_solver = true;
+		}
+		else if (arg == "--batch")
+		{
+			batch = true;
+		}
+		else if (arg.rfind("--threads=", 0) == 0 && std::atoi(arg.c_str() + 10) > 0)
+		{
+			num_threads = std::atoi(arg.c_str() + 10);
+		}
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--engine=paths|--engine=cells] [--batch [--threads=N]]\n";
+			return 1;
+		}
+	}
+
+	if (batch)
+		return run_batch(std::cin, num_threads, use_cells_solver);
+
+	std::cout << "Enter n: ";
+	int n_;
+	std::cin >> n_;
+	if (n_ != n)
+	{
+		std::cerr << "program was compiled for n=" << n << '\n';
+		return 1;
+	}
+
+	Board board;
+	std::cout << "Created board with side " << n << std::endl;
+
+	std::cout << "Enter numbers of top lasers: ";
+	read_lasers(std::cin, board, UpDir);
+	std::cout << "Enter numbers of right lasers: ";
+	read_lasers(std::cin, board, RightDir);
+	std::cout << "Enter numbers of bottom lasers: ";
+	read_lasers(std::cin, board, DownDir);
+	std::cout << "Enter numbers of left lasers: ";
+	read_lasers(std::cin, board, LeftDir);
+
+	std::cout << "Board:\n" << board;
+	std::cout << "Solving..." << std::endl;
+
+	solve(board, use_cells_solver, [&](Board const & solved_board)
+	{
+		print_answer(board, solved_board);
+	});
 }
@@ -1,51 +1,99 @@
 #include "hints.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <limits>
+#include <numeric>
 
-bool is_multiple_of(uint64_t const number, int arg)
+std::string number_to_string(Number number)
+{
+	char digits[max_number_len + 1];
+	int idx = sizeof(digits);
+	do
+	{
+		digits[--idx] = (char)('0' + number % 10);
+		number /= 10;
+	} while (number != 0);
+	return std::string(&digits[idx], &digits[sizeof(digits)]);
+}
+
+// Calls fun(digit) for each digit of number, from the least significant one. Wide numbers are split into 64-bit parts
+// of 19 digits, so that most of the divisions are 64-bit.
+template<typename Fun>
+static void for_each_digit(Number number, Fun fun)
+{
+#ifdef NUMBER_CROSS_WIDE
+	uint64_t constexpr part_pow = 10000000000000000000u; // 10^19
+	while (number > std::numeric_limits<uint64_t>::max())
+	{
+		uint64_t part = (uint64_t)(number % part_pow);
+		number /= part_pow;
+		for (int idx = 0; idx < 19; ++idx, part /= 10)
+			fun((uint32_t)(part % 10));
+	}
+#endif
+	for (uint64_t num = (uint64_t)number; num != 0; num /= 10)
+		fun((uint32_t)(num % 10));
+}
+
+// return value: the largest x such that x * x <= number
+static Number floor_sqrt(Number const number)
+{
+	if (number == 0)
+		return 0;
+	// The floating point estimate has 53 significant bits, so it is off by hundreds for the longest wide numbers. One
+	// Newton step from any root > 0 gives at least the result, and the next ones go down to it (quadratically, so
+	// starting from the estimate takes a step or two). The sums below do not overflow as number has at most
+	// max_number_len digits.
+	Number root = (Number)std::sqrt((double)number);
+	root = (root + number / root) / 2;
+	for (Number next = (root + number / root) / 2; next < root; next = (root + number / root) / 2)
+		root = next;
+	return root;
+}
+
+bool is_multiple_of(Number const number, int arg)
 {
 	return number % arg == 0;
 }
 
-bool is_square(uint64_t const number, int /*arg*/)
+bool is_square(Number const number, int /*arg*/)
 {
-	uint32_t const maybe_root = (uint32_t)std::sqrt(double(number));
-	return (uint64_t)maybe_root * maybe_root == number;
+	Number const root = floor_sqrt(number);
+	return root * root == number;
 }
 
-bool product_of_digits_is(uint64_t const number, int arg)
+bool product_of_digits_is(Number const number, int arg)
 {
+	// the product is capped above arg, so that it does not overflow for long numbers
 	uint64_t product = 1;
-	uint64_t num = number;
-	while (num)
+	bool has_zero = false;
+	for_each_digit(number, [&](uint32_t digit)
 	{
-		uint32_t digit = num % 10;
-		num = num / 10;
-
-		product *= digit;
-	}
-	return product == (uint32_t)arg;
+		has_zero |= digit == 0;
+		product = std::min<uint64_t>(product * digit, (uint64_t)(uint32_t)arg + 1);
+	});
+	return has_zero ? arg == 0 : product == (uint32_t)arg;
 }
 
-bool is_divisible_by_each_of_digits(uint64_t const number, int /*arg*/)
+bool is_divisible_by_each_of_digits(Number const number, int /*arg*/)
 {
-	uint64_t num = number;
-	while (num)
+	// each digit divides 2520
+	uint32_t const rest = (uint32_t)(number % 2520);
+	bool is_ok = true;
+	for_each_digit(number, [&](uint32_t digit)
 	{
-		uint32_t digit = num % 10;
-		num = num / 10;
-
-		if (digit == 0 || number % digit != 0)
-			return false;
-	}
-	return true;
+		is_ok &= digit != 0 && rest % digit == 0;
+	});
+	return is_ok;
 }
 
-bool is_odd_and_palindrome(uint64_t const number, int /*arg*/)
+bool is_odd_and_palindrome(Number const number, int /*arg*/)
 {
 	if (number % 2 == 0)
 		return false;
-	std::string str = std::to_string(number);
+	std::string str = number_to_string(number);
 	int const len = (int)str.size();
 	for (int i = 0; i < len / 2; ++i)
 	{
@@ -55,33 +103,191 @@ bool is_odd_and_palindrome(uint64_t const number, int /*arg*/)
 	return true;
 }
 
-bool is_fibonacci(uint64_t const number, int /*arg*/)
+bool is_fibonacci(Number const number, int /*arg*/)
 {
-	uint64_t a = 0;
-	uint64_t b = 1;
+	Number a = 0;
+	Number b = 1;
 	while (b <= number)
 	{
 		if (b == number)
 			return true;
-		uint64_t tmp = a;
+		Number tmp = a;
 		a = b;
 		b = tmp + b;
 	}
 	return false;
 }
 
-bool is_prime(uint64_t const number, int /*arg*/)
+// High and low halves of the product of a and b.
+static void multiply_wide(uint64_t const a, uint64_t const b, uint64_t & high, uint64_t & low)
+{
+	unsigned __int128 const product = (unsigned __int128)a * b;
+	high = (uint64_t)(product >> 64);
+	low = (uint64_t)product;
+}
+
+#ifdef NUMBER_CROSS_WIDE
+static void multiply_wide(unsigned __int128 const a, unsigned __int128 const b, unsigned __int128 & high,
+		unsigned __int128 & low)
+{
+	// schoolbook multiplication of 64-bit halves, the middle sum has at most 66 bits
+	unsigned __int128 const low_low = (unsigned __int128)(uint64_t)a * (uint64_t)b;
+	unsigned __int128 const low_high = (unsigned __int128)(uint64_t)a * (uint64_t)(b >> 64);
+	unsigned __int128 const high_low = (unsigned __int128)(uint64_t)(a >> 64) * (uint64_t)b;
+	unsigned __int128 const high_high = (unsigned __int128)(uint64_t)(a >> 64) * (uint64_t)(b >> 64);
+	unsigned __int128 const middle = (low_low >> 64) + (uint64_t)low_high + (uint64_t)high_low;
+	low = middle << 64 | (uint64_t)low_low;
+	high = high_high + (low_high >> 64) + (high_low >> 64) + (middle >> 64);
+}
+#endif
+
+/*
+ * Multiplication modulo an odd modulus in Montgomery form: x is kept as x * R mod modulus, where R = 2^bits of Word,
+ * and the product is reduced by multiplications and a shift instead of a division. Word is uint64_t, or
+ * unsigned __int128 in the wide build, for which a division is a slow library call.
+ */
+template<typename Word>
+class Montgomery
 {
-	uint32_t i = 2;
-	while ((uint64_t)i * i <= number)
+public:
+	explicit Montgomery(Word const modulus):
+		modulus(modulus),
+		neg_inverse(compute_neg_inverse(modulus)),
+		r_squared(compute_r_squared(modulus))
+	{
+		assert(modulus % 2 == 1);
+	}
+
+	Word to_form(Word const x) const
+	{
+		return multiply(x % modulus, r_squared);
+	}
+
+	Word multiply(Word const a, Word const b) const
+	{
+		Word high, low;
+		multiply_wide(a, b, high, low);
+		return reduce(high, low);
+	}
+
+	Word power(Word base, Word exponent) const
+	{
+		Word result = to_form(1);
+		for (; exponent != 0; exponent >>= 1)
+		{
+			if (exponent & 1)
+				result = multiply(result, base);
+			base = multiply(base, base);
+		}
+		return result;
+	}
+
+private:
+	static constexpr int bits = 8 * sizeof(Word);
+
+	// -modulus^-1 mod R, by Newton's iteration which doubles the number of correct low bits (an odd number is its own
+	// inverse modulo 8)
+	static Word compute_neg_inverse(Word const modulus)
+	{
+		Word inverse = modulus;
+		for (int correct_bits = 3; correct_bits < bits; correct_bits *= 2)
+			inverse *= 2 - modulus * inverse;
+		return -inverse;
+	}
+
+	// R^2 mod modulus, by doubling R mod modulus
+	static Word compute_r_squared(Word const modulus)
+	{
+		Word result = -modulus % modulus;
+		for (int i = 0; i < bits; ++i)
+			result = result >= modulus - result ? result - (modulus - result) : result + result;
+		return result;
+	}
+
+	// (high * R + low) / R mod modulus, for high < modulus
+	Word reduce(Word const high, Word const low) const
+	{
+		// low + m * modulus is divisible by R, and the sum is less than 2 * modulus, it can overflow Word though
+		Word const m = low * neg_inverse;
+		Word m_high, m_low;
+		multiply_wide(m, modulus, m_high, m_low);
+		Word result = high + m_high;
+		bool carry = result < high;
+		Word const low_carry = low != 0;
+		result += low_carry;
+		carry |= result < low_carry;
+		return carry || result >= modulus ? result - modulus : result;
+	}
+
+	Word const modulus;
+	Word const neg_inverse;
+	Word const r_squared;
+};
+
+// Miller-Rabin test of an odd number > 2 to each of the bases, it is false only if the number is composite.
+template<typename Word>
+static bool is_strong_probable_prime(Word const number, uint64_t const * bases, int num_bases)
+{
+	Montgomery<Word> const montgomery(number);
+	Word odd_part = number - 1;
+	int num_twos = 0;
+	for (; odd_part % 2 == 0; odd_part /= 2)
+		++num_twos;
+	Word const one = montgomery.to_form(1);
+	Word const minus_one = number - one;
+
+	for (int base_idx = 0; base_idx < num_bases; ++base_idx)
 	{
-		if (number % i == 0)
+		Word const base = bases[base_idx] % number;
+		if (base == 0)
+			continue;
+		Word x = montgomery.power(montgomery.to_form(base), odd_part);
+		if (x == one || x == minus_one)
+			continue;
+		bool is_witness = true;
+		for (int i = 1; i < num_twos && is_witness; ++i)
+		{
+			x = montgomery.multiply(x, x);
+			is_witness = x != minus_one;
+		}
+		if (is_witness)
 			return false;
-		++i;
 	}
 	return true;
 }
 
+bool is_prime(Number const number, int /*arg*/)
+{
+	// trial division is faster for small numbers
+	if (number < (1 << 16))
+	{
+		uint32_t i = 2;
+		while (i * i <= number)
+		{
+			if (number % i == 0)
+				return false;
+			++i;
+		}
+		return true;
+	}
+	if (number % 2 == 0)
+		return false;
+
+#ifdef NUMBER_CROSS_WIDE
+	if (number > std::numeric_limits<uint64_t>::max())
+	{
+		// The first 13 primes as bases tell all primes below 3317044064679887385961981 (Sorenson and Webster). No such
+		// set is proven for longer numbers, for them more bases make it very unlikely that a composite passes.
+		static uint64_t const bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71};
+		Number const proven_limit = (Number)3317044064679u * 1000000000000u + 887385961981u;
+		return is_strong_probable_prime<Number>(number, bases, number < proven_limit ? 13 : 20);
+	}
+#endif
+	// these bases tell all 64-bit primes (Jim Sinclair)
+	static uint64_t const bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+	return is_strong_probable_prime<uint64_t>((uint64_t)number, bases, sizeof(bases) / sizeof(bases[0]));
+}
+
 CheckHintsFun get_hints_fun(std::string const & name)
 {
 	if (name == "multiple")
@@ -101,3 +307,186 @@ CheckHintsFun get_hints_fun(std::string const & name)
 
 	return nullptr;
 }
+
+HintDigits get_hint_digits(CheckHintsFun fun, int arg)
+{
+	HintDigits result;
+	result.allowed_digits = 0x3ff;
+	for (int8_t & count : result.max_digit_count)
+		count = HintDigits::unbounded_count;
+
+	if (fun == is_divisible_by_each_of_digits)
+	{
+		result.allowed_digits &= ~1;
+	}
+	else if (fun == product_of_digits_is && arg != 0)
+	{
+		// digits other than 1 are made of factors of arg, so they can be there as many times as their factors are
+		int const primes[4] = {2, 3, 5, 7};
+		int prime_count[4] = {};
+		int rest = arg;
+		for (int i = 0; i < 4; ++i)
+		{
+			while (rest > 0 && rest % primes[i] == 0)
+			{
+				rest /= primes[i];
+				++prime_count[i];
+			}
+		}
+		result.allowed_digits = 0;
+		if (rest == 1)
+		{
+			result.allowed_digits |= 1 << 1;
+			for (int digit = 2; digit <= 9; ++digit)
+			{
+				int max_count = HintDigits::unbounded_count;
+				int digit_rest = digit;
+				for (int i = 0; i < 4; ++i)
+				{
+					int digit_prime_count = 0;
+					for (; digit_rest % primes[i] == 0; digit_rest /= primes[i])
+						++digit_prime_count;
+					if (digit_prime_count > 0)
+						max_count = std::min(max_count, prime_count[i] / digit_prime_count);
+				}
+				result.max_digit_count[digit] = max_count;
+				if (max_count > 0)
+					result.allowed_digits |= 1 << digit;
+			}
+		}
+		result.max_digit_count[0] = 0;
+	}
+
+	return result;
+}
+
+// return value: the smallest x such that x * x >= number
+static Number ceil_sqrt(Number const number)
+{
+	Number const root = floor_sqrt(number);
+	return root * root == number ? root : root + 1;
+}
+
+bool can_satisfy_hint(CheckHintsFun fun, int arg, int8_t const * digits, int len, uint32_t fixed_digits)
+{
+	assert(len >= 1 && len <= max_number_len && len <= 32);
+	uint32_t const all_digits = (uint32_t)(((uint64_t)1 << len) - 1);
+	fixed_digits &= all_digits;
+
+	// the number is in [min_number; max_number] according to its leading fixed digits
+	int num_leading = 0;
+	Number min_number = 0;
+	for (; num_leading < len && fixed_digits >> num_leading & 1; ++num_leading)
+		min_number = min_number * 10 + digits[num_leading];
+	Number rest_pow = 1;
+	for (int i = num_leading; i < len; ++i)
+		rest_pow *= 10;
+	min_number *= rest_pow;
+	Number const max_number = min_number + rest_pow - 1;
+	if (fixed_digits == all_digits)
+		return fun(min_number, arg);
+
+	// the number is trailing modulo trailing_pow according to its trailing fixed digits
+	int num_trailing = 0;
+	Number trailing = 0;
+	Number trailing_pow = 1;
+	for (; num_trailing < len && fixed_digits >> (len - 1 - num_trailing) & 1; ++num_trailing)
+	{
+		trailing += digits[len - 1 - num_trailing] * trailing_pow;
+		trailing_pow *= 10;
+	}
+
+	if (fun == is_multiple_of)
+	{
+		// gcd(arg, trailing_pow) is gcd(arg, trailing_pow mod arg), which keeps it in 64 bits
+		if (trailing % std::gcd<uint64_t, uint64_t>(arg, (uint64_t)(trailing_pow % arg)) != 0)
+			return false;
+		return max_number / arg * arg >= min_number;
+	}
+	if (fun == is_square)
+	{
+		if (num_trailing > 0)
+		{
+			// squares modulo 10 and 100
+			uint32_t const modulus = num_trailing == 1 ? 10 : 100;
+			bool is_residue = false;
+			for (uint32_t x = 0; x < modulus && !is_residue; ++x)
+				is_residue = x * x % modulus == trailing % modulus;
+			if (!is_residue)
+				return false;
+		}
+		Number const root = ceil_sqrt(min_number);
+		return root * root <= max_number;
+	}
+	if (fun == product_of_digits_is)
+	{
+		if (arg == 0)
+			return true; // a digit which is not fixed can be 0
+		uint64_t product = 1;
+		int num_free_digits = len;
+		for (int i = 0; i < len; ++i)
+		{
+			if (fixed_digits >> i & 1)
+			{
+				product *= digits[i];
+				--num_free_digits;
+				// checked here so that the product does not overflow for long numbers
+				if (product == 0 || product > (uint64_t)arg)
+					return false;
+			}
+		}
+		if (arg % product != 0)
+			return false;
+		// the rest of arg must be a product of digits which are not fixed
+		uint64_t max_rest = 1;
+		for (int i = 0; i < num_free_digits && max_rest < (uint64_t)arg; ++i)
+			max_rest *= 9;
+		return arg / product <= max_rest;
+	}
+	if (fun == is_divisible_by_each_of_digits)
+	{
+		for (int i = 0; i < len; ++i)
+		{
+			if (fixed_digits >> i & 1)
+			{
+				// divisibility by digits[i] depends on trailing digits if it has common factors with 10
+				if (digits[i] == 0
+						|| trailing % std::gcd<uint64_t, uint64_t>(digits[i], (uint64_t)(trailing_pow % digits[i])) != 0)
+					return false;
+			}
+		}
+		return true;
+	}
+	if (fun == is_odd_and_palindrome)
+	{
+		if (num_trailing > 0 && trailing % 2 == 0)
+			return false;
+		for (int i = 0; i < len / 2; ++i)
+		{
+			int const j = len - 1 - i;
+			if ((fixed_digits >> i & 1) && (fixed_digits >> j & 1) && digits[i] != digits[j])
+				return false;
+		}
+		return true;
+	}
+	if (fun == is_fibonacci)
+	{
+		Number a = 0;
+		Number b = 1;
+		while (b < min_number)
+		{
+			Number tmp = a;
+			a = b;
+			b = tmp + b;
+		}
+		return b <= max_number;
+	}
+	if (fun == is_prime)
+	{
+		// primes with more than one digit end with 1, 3, 7 or 9
+		if (num_trailing > 0 && (trailing % 2 == 0 || trailing % 5 == 0))
+			return false;
+		return true;
+	}
+	return true;
+}
@@ -4,23 +4,54 @@
 #include <string>
 #include <cstdint>
 
+// Numbers of rows. With NUMBER_CROSS_WIDE defined (the number_cross_wide build, for boards with more columns) they are
+// 128-bit, so that numbers of more than 19 digits fit, otherwise 64-bit arithmetic is kept as it is faster.
+#ifdef NUMBER_CROSS_WIDE
+using Number = unsigned __int128;
+#else
+using Number = uint64_t;
+#endif
+
+// the longest number of digits that always fits in Number
+static constexpr int max_number_len = sizeof(Number) == 8 ? 19 : 38;
+
+std::string number_to_string(Number number);
+
 // returns true if hint condition is satisfied for the number, parametrized by arg
-typedef bool (*CheckHintsFun)(uint64_t number, int arg);
+typedef bool (*CheckHintsFun)(Number number, int arg);
 
-bool is_multiple_of(uint64_t number, int arg);
+bool is_multiple_of(Number number, int arg);
 
-bool is_square(uint64_t number, int /*arg*/);
+bool is_square(Number number, int /*arg*/);
 
-bool product_of_digits_is(uint64_t number, int arg);
+bool product_of_digits_is(Number number, int arg);
 
-bool is_divisible_by_each_of_digits(uint64_t number, int /*arg*/);
+bool is_divisible_by_each_of_digits(Number number, int /*arg*/);
 
-bool is_odd_and_palindrome(uint64_t number, int /*arg*/);
+bool is_odd_and_palindrome(Number number, int /*arg*/);
 
-bool is_fibonacci(uint64_t number, int /*arg*/);
+bool is_fibonacci(Number number, int /*arg*/);
 
-bool is_prime(uint64_t number, int /*arg*/);
+bool is_prime(Number number, int /*arg*/);
 
 CheckHintsFun get_hints_fun(std::string const & name);
 
+// Digits that can appear in a number satisfying a hint, and how many times at most each one can appear in it.
+struct HintDigits
+{
+	static constexpr int8_t unbounded_count = 127;
+
+	uint16_t allowed_digits; // bit d is set if digit d can appear
+	int8_t max_digit_count[10];
+};
+
+// Derived from hint's definition, it is exact for product_of_digits_is and does not restrict anything for others
+// (apart from is_divisible_by_each_of_digits not allowing 0).
+HintDigits get_hint_digits(CheckHintsFun fun, int arg);
+
+// Returns false if no number of len digits (1 <= len <= max_number_len, and len <= 32), which has digits[i] as its i'th
+// digit (counted from the most significant one) for each i in fixed_digits (bit i is for digit i), satisfies the hint.
+// Other digits are unknown. It is exact when all digits are fixed, otherwise it may return true for hopeless numbers.
+bool can_satisfy_hint(CheckHintsFun fun, int arg, int8_t const * digits, int len, uint32_t fixed_digits);
+
 #endif // _HINTS_H_
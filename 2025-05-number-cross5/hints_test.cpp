@@ -96,6 +96,108 @@ void test_is_prime()
 	std::cout << "End of list\n";
 }
 
+void test_is_prime_large()
+{
+	std::cout << __func__ << "()\n";
+	assert(is_prime(((Number)1 << 61) - 1, -1));
+	assert(!is_prime(((Number)1 << 62) - 1, -1));
+	// strong pseudoprime to bases 2, 3, ..., 37
+	assert(!is_prime(3825123056546413051ull, -1));
+	assert(is_prime(18446744073709551557ull, -1)); // largest 64-bit prime
+#ifdef NUMBER_CROSS_WIDE
+	assert(is_prime(((Number)1 << 89) - 1, -1));
+	assert(is_prime(((Number)1 << 127) - 1, -1));
+	assert(!is_prime(((Number)1 << 67) - 1, -1));
+	// strong pseudoprime to bases 2, 3, ..., 37, 3317044064679887385961981 = 3317044 * 10^18 + 64679887385961981
+	Number const pseudoprime = (Number)3317044 * 1'000'000'000'000'000'000ull + 64679887385961981ull;
+	assert(number_to_string(pseudoprime) == "3317044064679887385961981");
+	assert(!is_prime(pseudoprime, -1));
+	(void)pseudoprime;
+#endif
+}
+
+void test_is_square_large()
+{
+	std::cout << __func__ << "()\n";
+	Number const root = 4'294'967'295ull;
+	assert(is_square(root * root, -1));
+	assert(!is_square(root * root - 1, -1));
+	assert(!is_square(root * root + 1, -1));
+#ifdef NUMBER_CROSS_WIDE
+	Number const wide_root = 9'999'999'999'999'999'967ull;
+	assert(number_to_string(wide_root * wide_root) == "99999999999999999340000000000000001089");
+	assert(is_square(wide_root * wide_root, -1));
+	assert(!is_square(wide_root * wide_root - 1, -1));
+	assert(!is_square(wide_root * wide_root + 1, -1));
+	assert(!is_square(wide_root * wide_root + 2 * wide_root, -1));
+	assert(is_square((wide_root + 1) * (wide_root + 1), -1));
+	(void)wide_root;
+#endif
+	(void)root;
+}
+
+void test_get_hint_digits()
+{
+	std::cout << __func__ << "()\n";
+	HintDigits digits = get_hint_digits(product_of_digits_is, 20);
+	assert(digits.allowed_digits == (1 << 1 | 1 << 2 | 1 << 4 | 1 << 5));
+	assert(digits.max_digit_count[1] == HintDigits::unbounded_count);
+	assert(digits.max_digit_count[2] == 2);
+	assert(digits.max_digit_count[4] == 1);
+	assert(digits.max_digit_count[5] == 1);
+	assert(digits.max_digit_count[3] == 0);
+
+	digits = get_hint_digits(product_of_digits_is, 2025);
+	assert(digits.allowed_digits == (1 << 1 | 1 << 3 | 1 << 5 | 1 << 9));
+	assert(digits.max_digit_count[3] == 4);
+	assert(digits.max_digit_count[9] == 2);
+	assert(digits.max_digit_count[5] == 2);
+
+	digits = get_hint_digits(product_of_digits_is, 22);
+	assert(digits.allowed_digits == 0);
+
+	digits = get_hint_digits(is_divisible_by_each_of_digits, -1);
+	assert(digits.allowed_digits == 0x3fe);
+
+	digits = get_hint_digits(is_prime, -1);
+	assert(digits.allowed_digits == 0x3ff);
+	assert(digits.max_digit_count[7] == HintDigits::unbounded_count);
+}
+
+void test_can_satisfy_hint()
+{
+	std::cout << __func__ << "()\n";
+	int8_t const digits[4] = {1, 3, 4, 5};
+	// all fixed
+	assert(can_satisfy_hint(is_multiple_of, 5, digits, 4, 0xf));
+	assert(!can_satisfy_hint(is_multiple_of, 4, digits, 4, 0xf));
+	// 1??5
+	assert(!can_satisfy_hint(is_multiple_of, 2, digits, 4, 0x9));
+	assert(can_satisfy_hint(is_multiple_of, 25, digits, 4, 0x9));
+	assert(!can_satisfy_hint(is_multiple_of, 4000, digits, 4, 0x1));
+	// ?345
+	assert(!can_satisfy_hint(is_square, -1, digits, 4, 0xe));
+	assert(can_satisfy_hint(is_square, -1, digits, 4, 0x1));
+	// 13??
+	assert(!can_satisfy_hint(is_square, -1, digits, 2, 0x3));
+	assert(can_satisfy_hint(product_of_digits_is, 3 * 4 * 9, digits, 4, 0x6));
+	assert(!can_satisfy_hint(product_of_digits_is, 3 * 4 * 9 * 9 * 2, digits, 4, 0x6));
+	assert(!can_satisfy_hint(product_of_digits_is, 3 * 7, digits, 4, 0x6));
+	// ??45 is not divisible by 4
+	assert(!can_satisfy_hint(is_divisible_by_each_of_digits, -1, digits, 4, 0xc));
+	assert(can_satisfy_hint(is_divisible_by_each_of_digits, -1, digits, 4, 0xa));
+	assert(!can_satisfy_hint(is_odd_and_palindrome, -1, digits, 4, 0x9));
+	assert(!can_satisfy_hint(is_odd_and_palindrome, -1, digits, 3, 0x5));
+	assert(can_satisfy_hint(is_odd_and_palindrome, -1, digits, 3, 0x1));
+	assert(!can_satisfy_hint(is_prime, -1, digits, 4, 0x8));
+	// 15?? contains 1597, 15? does not contain any Fibonacci number
+	int8_t const fibonacci_digits[4] = {1, 5, 0, 0};
+	assert(can_satisfy_hint(is_fibonacci, -1, fibonacci_digits, 4, 0x3));
+	assert(!can_satisfy_hint(is_fibonacci, -1, fibonacci_digits, 3, 0x3));
+	(void)digits;
+	(void)fibonacci_digits;
+}
+
 int main()
 {
 	test_is_multiple_of();
@@ -105,4 +207,8 @@ int main()
 	test_is_odd_and_palindrome();
 	test_is_fibonacci();
 	test_is_prime();
+	test_is_prime_large();
+	test_is_square_large();
+	test_get_hint_digits();
+	test_can_satisfy_hint();
 }
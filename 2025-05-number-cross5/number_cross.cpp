@@ -1,23 +1,68 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "hints.h"
 #include "utils.h"
 
+// Serializes output of solver threads (logs and found solutions).
+std::mutex output_mutex;
+
+#ifndef NDEBUG
+// Number of heap allocations made so far, the search itself should not make any once it runs at full depth. Global new
+// and delete are replaced to count them in debug config only, release binary uses the ones of the standard library.
+std::atomic<uint64_t> num_heap_allocations(0);
+
+// Replacements of global new and delete are not inlined, otherwise GCC warns about free() of a pointer from new.
+[[gnu::noinline]] void * operator new(std::size_t size)
+{
+	num_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void * ptr = std::malloc(size != 0 ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void * ptr) noexcept
+{
+	std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void * ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
+
 #if 1
 // DBG logging enabled
-#define DBG(expr) expr
+#define DBG(expr) do { std::lock_guard<std::mutex> dbg_lock(output_mutex); expr; } while (0)
 #else
 #define DBG(expr) do {} while (0)
 #endif
@@ -69,25 +114,81 @@ Pos const orthogonal_dirs[4] = {vec_up, vec_right, vec_down, vec_left};
 } // anonymous namespace
 
 
+static constexpr int max_num_rows = 16;
+#ifdef NUMBER_CROSS_WIDE
+static constexpr int max_num_cols = 32;
+using ColMask = uint32_t; // set of columns of a row, bit i is for column i
+#else
+static constexpr int max_num_cols = 16;
+using ColMask = uint16_t;
+#endif
+static constexpr int max_num_cells = max_num_rows * max_num_cols;
 static constexpr int max_num_regions = 16;
+static constexpr int min_number_len = 2;
 
-class Board
+/*
+ * Set of distinct numbers of fixed capacity, kept in an array in order of insertion. Numbers are removed by rolling
+ * back to an earlier size, which drops the ones inserted since.
+ */
+template<int capacity>
+class NumberSet
 {
 public:
-	struct Region
+	NumberSet():
+		num_numbers(0),
+		numbers()
 	{
-		// indices of regions that are adjacent (orthogonally) to us
-		std::vector<int8_t> neighbors_vec;
-		int8_t value = -1; // value of region or -1 if not set yet
-	};
+	}
+
+	// return value: true if number was not in the set
+	bool insert(Number number)
+	{
+		if (std::find(begin(), end(), number) != end())
+			return false;
+		assert(num_numbers < capacity);
+		numbers[num_numbers++] = number;
+		return true;
+	}
+
+	// Removes numbers inserted after size() was size.
+	void rollback(int size)
+	{
+		assert(size >= 0 && size <= num_numbers);
+		num_numbers = size;
+	}
+
+	int size() const
+	{
+		return num_numbers;
+	}
+
+	Number const * begin() const { return &numbers[0]; }
+	Number const * end() const { return &numbers[num_numbers]; }
+
+private:
+	int num_numbers;
+	Number numbers[capacity];
+};
+
+/*
+ * Board is made of the puzzle (regions, highlights, hints), which is read from input and then shared by copies of the
+ * board, and of the search state, which is stored inline in fixed-size arrays. Copying a board thus copies a few
+ * hundred bytes without allocating, and comparing boards is a memcmp() of their states.
+ */
+class Board
+{
+public:
+	static constexpr int max_num_tiles_per_row = max_num_cols;
+	// numbers in a row are separated by tiles
+	static constexpr int max_num_numbers = max_num_rows * (max_num_cols + 1) / 2;
 
 	struct Tile
 	{
 		int8_t col; // tile's column
 		// A set of orthogonally adjacent cells to which we can still displace (part of) our value, i'th bit represents
-		// position of tile_pos + orthogonal_dirs[i]. Bit value of true means that corresponding cell is in the set.
+		// position of tile_pos + orthogonal_dirs[i]. Bit value of 1 means that corresponding cell is in the set.
 		// When the set is empty, the tile's value must be 0.
-		std::bitset<4> cells_for_displacement;
+		uint8_t cells_for_displacement;
 
 		bool operator==(Tile const & other) const
 		{
@@ -95,80 +196,70 @@ public:
 		}
 	};
 
-	struct Row
+	// Tiles of a row, ordered by column. Unused entries are zeroed, so that rows can be compared with memcmp().
+	struct RowTiles
 	{
-		std::vector<Tile> tiles;
-
-		CheckHintsFun hints_fun;
-		int hints_arg;
+		int8_t num_tiles;
+		Tile tiles[max_num_tiles_per_row];
+
+		Tile const * begin() const { return &tiles[0]; }
+		Tile const * end() const { return &tiles[num_tiles]; }
+		int size() const { return num_tiles; }
+		bool empty() const { return num_tiles == 0; }
+		Tile const & operator[](int idx) const { return tiles[idx]; }
 	};
 
 	Board(int num_rows, int num_cols):
 		num_rows(num_rows),
 		num_cols(num_cols),
 		numbers_in_grid(),
-		cell_value(new int8_t[num_rows * num_cols]),
-		cell_region(new int8_t[num_rows * num_cols]),
-		cell_is_highlighted(num_rows * num_cols),
-		regions(),
-		rows(new Row[num_rows] {}),
-		row_is_processed(num_rows),
-		row_has_region_assignments(num_rows),
-		row_has_tiles_placement(num_rows)
-	{
-		std::fill(&cell_value[0], &cell_value[num_rows * num_cols], -1);
-		std::fill(&cell_region[0], &cell_region[num_rows * num_cols], -1);
-	}
-
-	Board(Board const & other):
-		num_rows(other.num_rows),
-		num_cols(other.num_cols),
-		numbers_in_grid(other.numbers_in_grid),
-		cell_value(new int8_t[num_rows * num_cols]),
-		cell_region(new int8_t[num_rows * num_cols]),
-		cell_is_highlighted(other.cell_is_highlighted, num_rows * num_cols),
-		regions(other.regions),
-		rows(new Row[num_rows]),
-		row_is_processed(other.row_is_processed, num_rows),
-		row_has_region_assignments(other.row_has_region_assignments, num_rows),
-		row_has_tiles_placement(other.row_has_tiles_placement, num_rows)
-	{
-		std::copy(&other.cell_value[0], &other.cell_value[num_rows * num_cols], &this->cell_value[0]);
-		std::copy(&other.cell_region[0], &other.cell_region[num_rows * num_cols], &this->cell_region[0]);
-		std::copy(&other.rows[0], &other.rows[num_rows], &this->rows[0]);
+		puzzle(std::make_shared<Puzzle>()),
+		state(),
+		row_cell_values_key(),
+		row_cell_values_changed(0),
+		key(0)
+	{
+		assert(num_rows > 0 && num_rows <= max_num_rows);
+		assert(num_cols > 0 && num_cols <= max_num_cols);
+		std::fill(&state.cell_value[0], &state.cell_value[max_num_cells], -1);
+		std::fill(&state.region_value[0], &state.region_value[max_num_regions], -1);
 	}
 
 	void set_num_regions(int n)
 	{
-		regions.resize(n);
+		assert(puzzle.use_count() == 1);
+		assert(n <= max_num_regions);
+		puzzle->num_regions = n;
 	}
 
 	int get_num_regions() const
 	{
-		return (int)regions.size();
+		return puzzle->num_regions;
 	}
 
 	std::vector<int8_t> const & get_region_neighbors(int region_idx) const
 	{
 		assert(region_idx >= 0 && region_idx < get_num_regions());
-		return regions[region_idx].neighbors_vec;
+		return puzzle->region_neighbors[region_idx];
 	}
 
 	int8_t get_region_value(int region_idx) const
 	{
 		assert(region_idx >= 0 && region_idx < get_num_regions());
-		return regions[region_idx].value;
+		return state.region_value[region_idx];
 	}
 
 	void set_region_value(int region_idx, int8_t val)
 	{
 		assert(region_idx >= 0 && region_idx < get_num_regions());
-		regions[region_idx].value = val;
+		key ^= region_value_key(region_idx, state.region_value[region_idx]) ^ region_value_key(region_idx, val);
+		state.region_value[region_idx] = val;
 	}
 
 	void compute_region_neighbors()
 	{
-		int const num_regions = regions.size();
+		assert(puzzle.use_count() == 1);
+		int const num_regions = get_num_regions();
 		std::vector<std::unordered_set<int8_t>> region_neighbors(num_regions);
 		for (int row = 0; row < num_rows; ++row)
 		{
@@ -195,8 +286,9 @@ public:
 		for (int region_idx = 0; region_idx < num_regions; ++region_idx)
 		{
 			std::unordered_set<int8_t> const & neigh_set = region_neighbors[region_idx];
-			std::copy(neigh_set.begin(), neigh_set.end(), std::back_inserter(regions[region_idx].neighbors_vec));
-			std::sort(regions[region_idx].neighbors_vec.begin(), regions[region_idx].neighbors_vec.end());
+			std::vector<int8_t> & neighbors_vec = puzzle->region_neighbors[region_idx];
+			std::copy(neigh_set.begin(), neigh_set.end(), std::back_inserter(neighbors_vec));
+			std::sort(neighbors_vec.begin(), neighbors_vec.end());
 		}
 	}
 
@@ -214,156 +306,399 @@ public:
 	int8_t get_cell_value(Pos const pos) const
 	{
 		assert(is_on_board(pos));
-		return cell_value[cell_index(pos)];
+		return state.cell_value[cell_index(pos)];
 	}
 
 	void set_cell_value(Pos const pos, int8_t val)
 	{
 		assert(is_on_board(pos));
-		cell_value[cell_index(pos)] = val;
+		state.cell_value[cell_index(pos)] = val;
+		// cell values are changed very often, so their part of the key is updated by get_key() only
+		row_cell_values_changed |= (uint32_t)1 << pos.row;
 	}
 
 	int8_t get_cell_region(Pos const pos) const
 	{
 		assert(is_on_board(pos));
-		return cell_region[cell_index(pos)];
+		return puzzle->cell_region[cell_index(pos)];
 	}
 
 	void set_cell_region(Pos const pos, int8_t val)
 	{
+		assert(puzzle.use_count() == 1);
 		assert(is_on_board(pos));
-		cell_region[cell_index(pos)] = val;
+		puzzle->cell_region[cell_index(pos)] = val;
 	}
 
 	bool get_cell_is_highlighted(Pos const pos) const
 	{
 		assert(is_on_board(pos));
-		return cell_is_highlighted.get_bit(cell_index(pos));
+		return puzzle->cell_is_highlighted[cell_index(pos)];
 	}
 
 	void set_cell_is_highlighted(Pos const pos, bool val)
 	{
+		assert(puzzle.use_count() == 1);
 		assert(is_on_board(pos));
-		if (val)
-			cell_is_highlighted.set_bit(cell_index(pos));
-		else
-			cell_is_highlighted.clear_bit(cell_index(pos));
+		puzzle->cell_is_highlighted[cell_index(pos)] = val;
 	}
 
 	void set_hints_fun(CheckHintsFun fun, int arg, int row)
 	{
+		assert(puzzle.use_count() == 1);
 		assert(row >= 0 && row < num_rows);
-		rows[row].hints_fun = fun;
-		rows[row].hints_arg = arg;
+		puzzle->row_hints_fun[row] = fun;
+		puzzle->row_hints_arg[row] = arg;
 	}
 
-	bool call_row_hints_fun(int row, uint64_t number) const
+	bool call_row_hints_fun(int row, Number number) const
 	{
 		assert(row >= 0 && row < num_rows);
-		return rows[row].hints_fun(number, rows[row].hints_arg);
+		return puzzle->row_hints_fun[row](number, puzzle->row_hints_arg[row]);
 	}
 
 	CheckHintsFun get_row_hints_fun(int row) const
 	{
 		assert(row >= 0 && row < num_rows);
-		return rows[row].hints_fun;
+		return puzzle->row_hints_fun[row];
+	}
+
+	int get_row_hints_arg(int row) const
+	{
+		assert(row >= 0 && row < num_rows);
+		return puzzle->row_hints_arg[row];
+	}
+
+	HintDigits const & get_row_hint_digits(int row) const
+	{
+		assert(row >= 0 && row < num_rows);
+		return puzzle->row_hint_digits[row];
+	}
+
+	// Digits the region's value can take according to hints, bit d is for digit d.
+	uint16_t get_region_allowed_digits(int region_idx) const
+	{
+		assert(region_idx >= 0 && region_idx < get_num_regions());
+		return puzzle->region_allowed_digits[region_idx];
+	}
+
+	// Derives digits allowed in each row from its hint. A highlighted cell is never a tile and never gets
+	// a displacement, so its value is the value of its region and it is a part of a number in its row.
+	void compute_hint_digits()
+	{
+		assert(puzzle.use_count() == 1);
+		for (int row = 0; row < num_rows; ++row)
+			puzzle->row_hint_digits[row] = get_hint_digits(puzzle->row_hints_fun[row], puzzle->row_hints_arg[row]);
+		for (int region_idx = 0; region_idx < get_num_regions(); ++region_idx)
+			puzzle->region_allowed_digits[region_idx] = 0x3fe;
+		for (int row = 0; row < num_rows; ++row)
+		{
+			for (int col = 0; col < num_cols; ++col)
+			{
+				if (get_cell_is_highlighted({row, col}))
+				{
+					puzzle->region_allowed_digits[get_cell_region({row, col})] &=
+						puzzle->row_hint_digits[row].allowed_digits;
+				}
+			}
+		}
+	}
+
+	// Precomputes tile placements, which depend only on highlights and board edges. A tile can be placed in a cell which
+	// is not highlighted and has a neighbor which is not highlighted, numbers between tiles must be at least
+	// min_number_len long.
+	void compute_tile_patterns()
+	{
+		assert(puzzle.use_count() == 1);
+		for (int row = 0; row < num_rows; ++row)
+		{
+			for (int col = 0; col < num_cols; ++col)
+			{
+				Pos const tile_pos {row, col};
+				uint8_t cells_for_displacement = 0;
+				if (!get_cell_is_highlighted(tile_pos))
+				{
+					for (int i = 0; i < 4; ++i)
+					{
+						Pos const pos_for_displacement = tile_pos + orthogonal_dirs[i];
+						if (is_on_board(pos_for_displacement) && !get_cell_is_highlighted(pos_for_displacement))
+							cells_for_displacement |= 1 << i;
+					}
+				}
+				puzzle->cell_cells_for_displacement[cell_index(tile_pos)] = cells_for_displacement;
+			}
+		}
+
+		for (int row = 0; row < num_rows; ++row)
+		{
+			std::vector<ColMask> & patterns = puzzle->row_tile_patterns[row];
+			// patterns are ordered by number of tiles, then lexicographically by columns of tiles
+			for (int num_tiles = 0; num_tiles <= num_cols; ++num_tiles)
+				add_tile_patterns(row, 0, num_tiles, 0, patterns);
+		}
+	}
+
+	// Valid tile placements in the row, as sets of columns (bit i is for column i).
+	std::vector<ColMask> const & get_row_tile_patterns(int row) const
+	{
+		assert(row >= 0 && row < num_rows);
+		return puzzle->row_tile_patterns[row];
+	}
+
+	// Initial cells_for_displacement of a tile placed at pos, 0 if no tile can be placed there.
+	uint8_t get_cell_cells_for_displacement(Pos const pos) const
+	{
+		assert(is_on_board(pos));
+		return puzzle->cell_cells_for_displacement[cell_index(pos)];
+	}
+
+	// Set of columns of tiles of the row (bit i is for column i), 0 for rows outside of the board.
+	ColMask get_row_tiles_cols(int row) const
+	{
+		if (row < 0 || row >= num_rows)
+			return 0;
+		return state.row_tiles_cols[row];
+	}
+
+	// Calls fun(number) for numbers of the row from left to right, numbers are separated by tiles. Cells of the row must
+	// have values.
+	template<typename Fun>
+	void for_each_row_number(int row, Fun const & fun) const
+	{
+		RowTiles const & tiles = get_row_tiles(row);
+		int start_col = 0;
+		for (int tile_idx = 0; tile_idx <= (int)tiles.size(); ++tile_idx)
+		{
+			int const end_col = tile_idx < (int)tiles.size() ? tiles[tile_idx].col : num_cols;
+			if (start_col < end_col)
+			{
+				Number number = 0;
+				for (int col = start_col; col < end_col; ++col)
+					number = number * 10 + get_cell_value({row, col});
+				fun(number);
+			}
+			start_col = end_col + 1;
+		}
+	}
+
+	RowTiles const & get_row_tiles(int row) const
+	{
+		assert(row >= 0 && row < num_rows);
+		return state.row_tiles[row];
+	}
+
+	void push_row_tile(int row, Tile const & tile)
+	{
+		assert(row >= 0 && row < num_rows);
+		RowTiles & row_tiles = state.row_tiles[row];
+		assert(row_tiles.num_tiles < max_num_tiles_per_row);
+		key ^= tile_key(row, tile);
+		row_tiles.tiles[row_tiles.num_tiles++] = tile;
+		state.row_tiles_cols[row] |= (ColMask)((ColMask)1 << tile.col);
 	}
 
-	std::vector<Tile> & get_row_tiles(int row)
+	void pop_row_tile(int row)
 	{
 		assert(row >= 0 && row < num_rows);
-		return rows[row].tiles;
+		RowTiles & row_tiles = state.row_tiles[row];
+		assert(row_tiles.num_tiles > 0);
+		Tile & tile = row_tiles.tiles[--row_tiles.num_tiles];
+		key ^= tile_key(row, tile);
+		state.row_tiles_cols[row] &= (ColMask)~((ColMask)1 << tile.col);
+		tile = {0, 0};
 	}
 
-	std::vector<Tile> const & get_row_tiles(int row) const
+	void set_tile_cells_for_displacement(int row, int tile_idx, uint8_t cells_for_displacement)
 	{
 		assert(row >= 0 && row < num_rows);
-		return rows[row].tiles;
+		assert(tile_idx >= 0 && tile_idx < state.row_tiles[row].num_tiles);
+		Tile & tile = state.row_tiles[row].tiles[tile_idx];
+		key ^= tile_key(row, tile);
+		tile.cells_for_displacement = cells_for_displacement;
+		key ^= tile_key(row, tile);
 	}
 
 	bool get_row_is_processed(int row) const
 	{
-		return row_is_processed.get_bit(row);
+		return get_row_flag(state.row_is_processed, row);
 	}
 
 	void set_row_is_processed(int row, bool val)
 	{
-		if (val)
-			row_is_processed.set_bit(row);
-		else
-			row_is_processed.clear_bit(row);
+		set_row_flag(state.row_is_processed, puzzle->zobrist_keys.row_is_processed, row, val);
 	}
 
 	bool get_row_has_region_assignments(int row) const
 	{
-		return row_has_region_assignments.get_bit(row);
+		return get_row_flag(state.row_has_region_assignments, row);
 	}
 
 	void set_row_has_region_assignments(int row, bool val)
 	{
-		if (val)
-			row_has_region_assignments.set_bit(row);
-		else
-			row_has_region_assignments.clear_bit(row);
+		set_row_flag(state.row_has_region_assignments, puzzle->zobrist_keys.row_has_region_assignments, row, val);
 	}
 
 	bool get_row_has_tiles_placement(int row) const
 	{
-		return row_has_tiles_placement.get_bit(row);
+		return get_row_flag(state.row_has_tiles_placement, row);
 	}
 
 	void set_row_has_tiles_placement(int row, bool val)
 	{
-		if (val)
-			row_has_tiles_placement.set_bit(row);
-		else
-			row_has_tiles_placement.clear_bit(row);
+		set_row_flag(state.row_has_tiles_placement, puzzle->zobrist_keys.row_has_tiles_placement, row, val);
 	}
 
-	// Not all fields need to be checked:
-	// - num_rows, num_cols: this is read from input file
+	// Only the search state needs to be checked:
+	// - num_rows, num_cols, puzzle: this is read from input file
 	// - numbers_in_grid: this is a function of cell values and tiles
-	// - cell_region: this is read from input file
-	// - cell_is_highlighted: this is read from input file
 	bool operator==(Board const & other) const
 	{
-		return std::equal(&cell_value[0], &cell_value[num_rows * num_cols], &other.cell_value[0]) &&
-			compare_region_values(other) &&
-			compare_row_tiles(other) &&
-			row_is_processed.is_equal(other.row_is_processed, num_rows) &&
-			row_has_region_assignments.is_equal(other.row_has_region_assignments, num_rows) &&
-			row_has_tiles_placement.is_equal(other.row_has_tiles_placement, num_rows);
+		assert(puzzle == other.puzzle);
+		return std::memcmp(&state, &other.state, sizeof(State)) == 0;
 	}
 
-	bool compare_region_values(Board const & other) const
+	// Zobrist key of the fields compared by operator==, it is updated incrementally by setters.
+	uint64_t get_key() const
 	{
-		int const num_regions = (int)regions.size();
-		assert((int)other.regions.size() == num_regions);
-		for (int i = 0; i < num_regions; ++i)
+		while (row_cell_values_changed)
 		{
-			if (regions[i].value != other.regions[i].value)
-				return false;
+			int const row = __builtin_ctz(row_cell_values_changed);
+			row_cell_values_changed &= row_cell_values_changed - 1;
+			uint64_t const row_key = compute_row_cell_values_key(row);
+			key ^= row_cell_values_key[row] ^ row_key;
+			row_cell_values_key[row] = row_key;
 		}
-		return true;
+		return key;
 	}
 
-	bool compare_row_tiles(Board const & other) const
+	// Hash of the part of the board that processing row depends on, apart from numbers in the grid: cells, tiles and
+	// flags of rows in [row-1; row+1], cells of rows row-2 and row+2 (tiles of adjacent rows may displace there) and
+	// columns of their tiles (tiles of adjacent rows can't be next to them), values of regions in these rows and of
+	// their neighbors. AssignRowRegionsValue propagates domains over the whole board, and a region without a value
+	// gets digits removed by its neighbors, so neighbors of such regions are included too, transitively. Propagation
+	// does not go on from regions with a value, as the boards it is called for are arc consistent.
+	uint64_t compute_row_neighborhood_key(int row) const
 	{
-		for (int row = 0; row < num_rows; ++row)
+		assert(row >= 0 && row < num_rows);
+		uint64_t result = row;
+		auto const mix = [&result](uint64_t value)
 		{
-			if (rows[row].tiles != other.rows[row].tiles)
-				return false;
+			result = (result ^ value) * 0x9e3779b97f4a7c15;
+			result ^= result >> 32;
+		};
+		uint32_t regions = 0;
+		for (int neighborhood_row = std::max(row - 2, 0); neighborhood_row <= std::min(row + 2, num_rows - 1);
+				++neighborhood_row)
+		{
+			for (int col = 0; col < num_cols; col += 8)
+			{
+				uint64_t values = 0;
+				std::memcpy(&values, &state.cell_value[cell_index({neighborhood_row, col})],
+						std::min(8, num_cols - col));
+				mix(values);
+			}
+			for (int col = 0; col < num_cols; ++col)
+				regions |= (uint32_t)1 << get_cell_region({neighborhood_row, col});
+			if (neighborhood_row < row - 1 || neighborhood_row > row + 1)
+			{
+				mix(state.row_tiles_cols[neighborhood_row]);
+				continue;
+			}
+			mix(get_row_has_region_assignments(neighborhood_row) | get_row_has_tiles_placement(neighborhood_row) << 1);
+			for (Tile const & tile : state.row_tiles[neighborhood_row])
+				mix((uint64_t)tile.col << 8 | tile.cells_for_displacement);
+			mix(state.row_tiles[neighborhood_row].num_tiles);
 		}
+		uint32_t near_regions = regions;
+		for (uint32_t rest = regions; rest != 0; rest &= rest - 1)
+		{
+			for (int8_t const neighbor_idx : get_region_neighbors(__builtin_ctz(rest)))
+				near_regions |= (uint32_t)1 << neighbor_idx;
+		}
+		for (uint32_t to_expand = near_regions & ~regions; to_expand != 0; )
+		{
+			int const region_idx = __builtin_ctz(to_expand);
+			to_expand &= to_expand - 1;
+			if (state.region_value[region_idx] != -1)
+				continue;
+			for (int8_t const neighbor_idx : get_region_neighbors(region_idx))
+			{
+				uint32_t const neighbor_bit = (uint32_t)1 << neighbor_idx;
+				if (!(near_regions & neighbor_bit))
+				{
+					near_regions |= neighbor_bit;
+					to_expand |= neighbor_bit;
+				}
+			}
+		}
+		for (uint32_t rest = near_regions; rest != 0; rest &= rest - 1)
+		{
+			int const region_idx = __builtin_ctz(rest);
+			mix((uint64_t)region_idx << 8 | (uint8_t)state.region_value[region_idx]);
+		}
+		// finalizer of splitmix64
+		result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9;
+		result = (result ^ (result >> 27)) * 0x94d049bb133111eb;
+		return result ^ (result >> 31);
+	}
+
+	// Toggles changes of the search state that lead from base to changed, this board must be derived from base too.
+	// Boards with changes in independent parts of the board (which don't touch the same bits) are combined this way,
+	// and toggling the same changes again undoes them. numbers_in_grid is left unchanged.
+	void toggle_changes(Board const & base, Board const & changed)
+	{
+		assert(puzzle == base.puzzle && puzzle == changed.puzzle);
+		unsigned char * const bytes = reinterpret_cast<unsigned char *>(&state);
+		unsigned char const * const base_bytes = reinterpret_cast<unsigned char const *>(&base.state);
+		unsigned char const * const changed_bytes = reinterpret_cast<unsigned char const *>(&changed.state);
+		for (std::size_t idx = 0; idx < sizeof(State); ++idx)
+			bytes[idx] ^= base_bytes[idx] ^ changed_bytes[idx];
+		for (int row = 0; row < num_rows; ++row)
+			row_cell_values_key[row] = compute_row_cell_values_key(row);
+		row_cell_values_changed = 0;
+		key = compute_key();
+	}
+
+	// Writes the search state as raw bytes, it can be read back only into a board of the same puzzle.
+	void write_state(std::ostream & out) const
+	{
+		out.write(reinterpret_cast<char const *>(&state), sizeof(State));
+	}
+
+	// Reads the search state written by write_state(). numbers_in_grid is left unchanged.
+	// return value: false if it could not be read
+	bool read_state(std::istream & in)
+	{
+		State read;
+		if (!in.read(reinterpret_cast<char *>(&read), sizeof(State)))
+			return false;
+		state = read;
+		for (int row = 0; row < num_rows; ++row)
+			row_cell_values_key[row] = compute_row_cell_values_key(row);
+		row_cell_values_changed = 0;
+		key = compute_key();
 		return true;
 	}
 
-	uint64_t compute_hash() const
+	// Computes the key from scratch, for checking get_key().
+	uint64_t compute_key() const
 	{
-		uint64_t const prime = 1000003;
 		uint64_t result = 0;
-		for (int i = 0; i < num_rows * num_cols; ++i)
+		for (int idx = 0; idx < num_rows * num_cols; ++idx)
+			result ^= cell_value_key(idx, state.cell_value[idx]);
+		for (int region_idx = 0; region_idx < get_num_regions(); ++region_idx)
+			result ^= region_value_key(region_idx, state.region_value[region_idx]);
+		ZobristKeys const & zobrist_keys = puzzle->zobrist_keys;
+		for (int row = 0; row < num_rows; ++row)
 		{
-			result = (result * prime) ^ cell_value[i];
+			for (Tile const & tile : state.row_tiles[row])
+				result ^= tile_key(row, tile);
+			if (get_row_is_processed(row))
+				result ^= zobrist_keys.row_is_processed[row];
+			if (get_row_has_region_assignments(row))
+				result ^= zobrist_keys.row_has_region_assignments[row];
+			if (get_row_has_tiles_placement(row))
+				result ^= zobrist_keys.row_has_tiles_placement[row];
 		}
 		return result;
 	}
@@ -371,33 +706,158 @@ public:
 	int num_rows;
 	int num_cols;
 
-	std::unordered_set<uint64_t> numbers_in_grid;
+	NumberSet<max_num_numbers> numbers_in_grid;
 
 private:
-	// This is a value seen on a cell, it includes displacements. The value gets set when processing a row, and
-	// is initially taken from the value of cell's region. It is -1 in rows not yet processed.
-	std::unique_ptr<int8_t[]> cell_value; // grid of cells
+	// Random keys of features of a board, the key of a board is xor of keys of its features. Unset values (-1) and
+	// false flags have key 0, so a new board has key 0.
+	struct ZobristKeys
+	{
+		static constexpr int num_values = 11; // -1..9
+
+		ZobristKeys()
+		{
+			// splitmix64 with a fixed seed, so that keys are the same in every run
+			uint64_t state = 0;
+			auto const next_key = [&state]()
+			{
+				uint64_t z = (state += 0x9e3779b97f4a7c15);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+				return z ^ (z >> 31);
+			};
+			for (uint64_t & key : cell_value)
+				key = next_key();
+			for (uint64_t & key : region_value)
+				key = next_key();
+			for (uint64_t & key : tile)
+				key = next_key();
+			for (int row = 0; row < max_num_rows; ++row)
+			{
+				row_is_processed[row] = next_key();
+				row_has_region_assignments[row] = next_key();
+				row_has_tiles_placement[row] = next_key();
+			}
+			for (int idx = 0; idx < max_num_cells; ++idx)
+				cell_value[idx * num_values] = 0;
+			for (int region_idx = 0; region_idx < max_num_regions; ++region_idx)
+				region_value[region_idx * num_values] = 0;
+		}
+
+		uint64_t cell_value[max_num_cells * num_values]; // [cell_index * num_values + value + 1]
+		uint64_t region_value[max_num_regions * num_values]; // [region_idx * num_values + value + 1]
+		uint64_t tile[max_num_cells * 16]; // [cell_index * 16 + cells_for_displacement]
+		uint64_t row_is_processed[max_num_rows];
+		uint64_t row_has_region_assignments[max_num_rows];
+		uint64_t row_has_tiles_placement[max_num_rows];
+	};
 
-	// index into regions
-	std::unique_ptr<int8_t[]> cell_region; // grid of cells
+	// Read-only data of the puzzle, shared by copies of the board (setters assert it is not shared yet).
+	struct Puzzle
+	{
+		int8_t cell_region[max_num_cells] = {}; // index into regions
+		bool cell_is_highlighted[max_num_cells] = {};
+		int num_regions = 0;
+		// indices of regions that are adjacent (orthogonally) to each region
+		std::vector<int8_t> region_neighbors[max_num_regions];
+		CheckHintsFun row_hints_fun[max_num_rows] = {};
+		int row_hints_arg[max_num_rows] = {};
+		HintDigits row_hint_digits[max_num_rows] = {};
+		uint16_t region_allowed_digits[max_num_regions] = {};
+		uint8_t cell_cells_for_displacement[max_num_cells] = {};
+		std::vector<ColMask> row_tile_patterns[max_num_rows];
+		ZobristKeys zobrist_keys;
+	};
+
+	// Search state, without padding so that it can be compared with memcmp().
+	struct State
+	{
+		// flags for each row, i'th bit is for row i
+		uint32_t row_is_processed;
+		uint32_t row_has_region_assignments;
+		uint32_t row_has_tiles_placement;
+		// This is a value seen on a cell, it includes displacements. The value gets set when processing a row, and
+		// is initially taken from the value of cell's region. It is -1 in rows not yet processed.
+		int8_t cell_value[max_num_cells];
+		int8_t region_value[max_num_regions]; // value of region or -1 if not set yet
+		ColMask row_tiles_cols[max_num_rows]; // columns of tiles in row_tiles
+		RowTiles row_tiles[max_num_rows];
+	};
+	static_assert(std::has_unique_object_representations<State>::value, "State must not have padding");
+	static_assert(max_num_rows <= 32, "row flags must fit in uint32_t");
+	static_assert(max_num_cols <= 8 * sizeof(ColMask), "columns of tiles in a row must fit in ColMask");
+
+	// Adds to patterns all valid placements of exactly remaining_tiles tiles in columns from start_col, cols contains
+	// tiles placed before start_col.
+	void add_tile_patterns(int row, int start_col, int remaining_tiles, ColMask cols,
+			std::vector<ColMask> & patterns) const
+	{
+		if (remaining_tiles == 0)
+		{
+			// the last number's length needs to be checked
+			int const number_len = num_cols - start_col;
+			if (number_len >= min_number_len || number_len == 0)
+				patterns.push_back(cols);
+			return;
+		}
+		for (int col = start_col; col < num_cols; ++col)
+		{
+			int const number_len = col - start_col;
+			if ((number_len >= min_number_len || (number_len == 0 && col == 0))
+					&& get_cell_cells_for_displacement({row, col}) != 0)
+			{
+				add_tile_patterns(row, col + 1, remaining_tiles - 1, cols | (ColMask)((ColMask)1 << col), patterns);
+			}
+		}
+	}
+
+	static bool get_row_flag(uint32_t flags, int row)
+	{
+		assert(row >= 0 && row < max_num_rows);
+		return flags >> row & 1;
+	}
+
+	void set_row_flag(uint32_t & flags, uint64_t const (&keys)[max_num_rows], int row, bool val)
+	{
+		assert(row >= 0 && row < num_rows);
+		if (val != get_row_flag(flags, row))
+		{
+			flags ^= (uint32_t)1 << row;
+			key ^= keys[row];
+		}
+	}
 
-	DynamicBitset cell_is_highlighted; // grid of cells
+	uint64_t compute_row_cell_values_key(int row) const
+	{
+		uint64_t row_key = 0;
+		for (int idx = row * num_cols; idx < (row + 1) * num_cols; ++idx)
+			row_key ^= cell_value_key(idx, state.cell_value[idx]);
+		return row_key;
+	}
 
-	std::vector<Region> regions;
+	uint64_t cell_value_key(int idx, int8_t val) const
+	{
+		assert(val >= -1 && val < ZobristKeys::num_values - 1);
+		return puzzle->zobrist_keys.cell_value[idx * ZobristKeys::num_values + val + 1];
+	}
 
-	std::unique_ptr<Row[]> rows; // for each row
-	DynamicBitset row_is_processed; // for each row
-	DynamicBitset row_has_region_assignments; // for each row
-	DynamicBitset row_has_tiles_placement; // for each row
-};
+	uint64_t region_value_key(int region_idx, int8_t val) const
+	{
+		assert(val >= -1 && val < ZobristKeys::num_values - 1);
+		return puzzle->zobrist_keys.region_value[region_idx * ZobristKeys::num_values + val + 1];
+	}
 
-template<>
-struct std::hash<Board>
-{
-	uint64_t operator()(Board const & board) const
+	uint64_t tile_key(int row, Tile const & tile) const
 	{
-		return board.compute_hash();
+		return puzzle->zobrist_keys.tile[cell_index({row, tile.col}) * 16 + tile.cells_for_displacement];
 	}
+
+	std::shared_ptr<Puzzle> puzzle;
+	State state;
+
+	mutable uint64_t row_cell_values_key[max_num_rows]; // part of key for cell values of each row
+	mutable uint32_t row_cell_values_changed; // rows whose row_cell_values_key is not up to date, i'th bit for row i
+	mutable uint64_t key;
 };
 
 std::ostream & operator<<(std::ostream & out, Board const & board)
@@ -416,7 +876,7 @@ std::ostream & operator<<(std::ostream & out, Board const & board)
 			}
 			else
 			{
-				std::vector<Board::Tile> const & tiles = board.get_row_tiles(row);
+				Board::RowTiles const & tiles = board.get_row_tiles(row);
 				auto it = std::find_if(tiles.begin(), tiles.end(), [col](Board::Tile const & tile)
 						{return tile.col == col;});
 				if (it != tiles.end())
@@ -443,13 +903,13 @@ std::ostream & operator<<(std::ostream & out, Board const & board)
 	}
 
 	out << "\nNumbers:";
-	uint64_t sum = 0;
-	for (uint64_t number : board.numbers_in_grid)
+	Number sum = 0;
+	for (Number number : board.numbers_in_grid)
 	{
-		out << ' ' << number;
+		out << ' ' << number_to_string(number);
 		sum += number;
 	}
-	out << "\nSum: " << sum << '\n';
+	out << "\nSum: " << number_to_string(sum) << '\n';
 
 	return out;
 }
@@ -463,8 +923,16 @@ Board read_data(std::istream & inp)
 	skipComments(inp);
 	inp >> num_rows >> num_cols;
 
-	assert(num_rows > 0 && num_rows <= std::numeric_limits<int8_t>::max());
-	assert(num_cols > 0 && num_cols <= std::numeric_limits<int8_t>::max());
+	assert(num_rows > 0 && num_cols > 0);
+	if (num_rows > max_num_rows || num_cols > max_num_cols)
+	{
+		std::cerr << "board too big, at most " << max_num_rows << 'x' << max_num_cols << " is supported\n";
+#ifndef NUMBER_CROSS_WIDE
+		if (num_rows <= max_num_rows)
+			std::cerr << "number_cross_wide supports boards with up to 32 columns\n";
+#endif
+		std::exit(1);
+	}
 
 	Board board(num_rows, num_cols);
 
@@ -525,6 +993,7 @@ Board read_data(std::istream & inp)
 		}
 		board.set_hints_fun(hints_fun, tmp, row);
 	}
+	board.compute_hint_digits();
 
 	skipComments(inp);
 	inp.exceptions(oldmask);
@@ -584,91 +1053,156 @@ void solve()
 }
 */
 
+// Callback is bool(), it is a template parameter so that the whole enumeration can be inlined.
+template<typename Callback>
 class AssignRowRegionsValue
 {
 public:
 	// Callback is called when each region in the row has a value assigned in [1; 9].
 	// return value: true if visiting should be continued
-	using Callback = std::function<bool()>;
-
 	AssignRowRegionsValue(Board & board, int row, Callback const & callback):
 		board(board),
 		callback(callback),
-		row(row)
+		row(row),
+		row_regions(0)
 	{
+		for (int col = 0; col < board.num_cols; ++col)
+			row_regions |= (uint32_t)1 << board.get_cell_region({row, col});
 	}
 
 	// return value: true if visiting should be continued
 	bool run()
 	{
-		return rec_visit(0);
+		// domains of regions with a value are that value, other ones start with digits allowed by hints and are reduced
+		// by propagation
+		Domains domains;
+		uint32_t single_digit_regions = 0;
+		for (int region_idx = 0; region_idx < board.get_num_regions(); ++region_idx)
+		{
+			int const value = board.get_region_value(region_idx);
+			domains[region_idx] = value == -1 ? board.get_region_allowed_digits(region_idx) : digit_bit(value);
+			if (domains[region_idx] == 0)
+				return true;
+			if (__builtin_popcount(domains[region_idx]) == 1)
+				single_digit_regions |= (uint32_t)1 << region_idx;
+		}
+		if (!propagate(domains, single_digit_regions))
+			return true;
+		return rec_visit(domains);
 	}
 
 private:
-	// col is the first one to try
-	bool rec_visit(int col)
+	// For each region a set of digits it can still take, bit d is for digit d.
+	using Domains = std::array<uint16_t, max_num_regions>;
+
+	static uint16_t digit_bit(int digit)
+	{
+		return (uint16_t)(1 << digit);
+	}
+
+	// Arc consistency for the constraints that neighboring regions have different values: the only digit of a region
+	// with a single-digit domain is removed from domains of its neighbors, which may make them single-digit in turn.
+	// regions is a set of regions whose domains became single-digit.
+	// return value: false if a domain became empty
+	bool propagate(Domains & domains, uint32_t regions) const
 	{
-		// advance col to the first cell with region without a value
-		while (col < board.num_cols && board.get_region_value(board.get_cell_region({row, col})) >= 0)
-			++col;
-		if (col < board.num_cols)
+		while (regions != 0)
 		{
-			// found region without a value
-			int const region_idx = board.get_cell_region({row, col});
-			assert(board.get_region_value(region_idx) == -1);
-			// try all possible digits for the region
-			for (int8_t digit = 1; digit <= 9; ++digit)
+			int const region_idx = __builtin_ctz(regions);
+			regions &= regions - 1;
+			uint16_t const digit = domains[region_idx];
+			assert(__builtin_popcount(digit) == 1);
+			for (int const neighbor_region_idx : board.get_region_neighbors(region_idx))
 			{
-				// check if digit can be set for this region
-				bool digit_is_ok = true;
-				for (int const neighbor_region_idx : board.get_region_neighbors(region_idx))
-				{
-					if (board.get_region_value(neighbor_region_idx) == digit)
-					{
-						digit_is_ok = false;
-						break;
-					}
-				}
-				if (digit_is_ok)
+				uint16_t & neighbor_domain = domains[neighbor_region_idx];
+				if (neighbor_domain & digit)
 				{
-					board.set_region_value(region_idx, digit);
-					bool const visit_more = rec_visit(col + 1);
-					board.set_region_value(region_idx, -1);
-					if (!visit_more)
+					neighbor_domain &= ~digit;
+					if (neighbor_domain == 0)
 						return false;
+					if (__builtin_popcount(neighbor_domain) == 1)
+						regions |= (uint32_t)1 << neighbor_region_idx;
 				}
 			}
+		}
+		return true;
+	}
 
-			return true;
+	// Picks the region in the row without a value to assign next (DSATUR): the one with the smallest domain, and
+	// among those the one with the most neighbors without a value.
+	// return value: -1 if all regions in the row have a value
+	int pick_region(Domains const & domains) const
+	{
+		int best_region_idx = -1;
+		int best_domain_size = 0;
+		int best_degree = 0;
+		for (uint32_t regions = row_regions; regions != 0; regions &= regions - 1)
+		{
+			int const region_idx = __builtin_ctz(regions);
+			if (board.get_region_value(region_idx) != -1)
+				continue;
+			int const domain_size = __builtin_popcount(domains[region_idx]);
+			if (best_region_idx != -1 && domain_size > best_domain_size)
+				continue;
+			int degree = 0;
+			for (int const neighbor_region_idx : board.get_region_neighbors(region_idx))
+			{
+				if (board.get_region_value(neighbor_region_idx) == -1)
+					++degree;
+			}
+			if (best_region_idx == -1 || domain_size < best_domain_size || degree > best_degree)
+			{
+				best_region_idx = region_idx;
+				best_domain_size = domain_size;
+				best_degree = degree;
+			}
 		}
-		else
+		return best_region_idx;
+	}
+
+	// domains are arc consistent
+	bool rec_visit(Domains const & domains)
+	{
+		int const region_idx = pick_region(domains);
+		if (region_idx == -1)
 		{
-			// all cells in the row checked
+			// all regions in the row have a value
 			return callback();
 		}
+
+		// try all digits left in the region's domain
+		assert(board.get_region_value(region_idx) == -1);
+		for (uint16_t digits = domains[region_idx]; digits != 0; digits &= digits - 1)
+		{
+			int8_t const digit = __builtin_ctz(digits);
+			Domains next_domains = domains;
+			next_domains[region_idx] = digit_bit(digit);
+			if (!propagate(next_domains, (uint32_t)1 << region_idx))
+				continue;
+
+			board.set_region_value(region_idx, digit);
+			bool const visit_more = rec_visit(next_domains);
+			board.set_region_value(region_idx, -1);
+			if (!visit_more)
+				return false;
+		}
+
+		return true;
 	}
 
 	Board & board;
 	Callback const callback;
 	int const row;
+	uint32_t row_regions; // set of regions of cells in the row
 };
 
-static constexpr int min_number_len = 2;
-
-static int max_num_tiles_in_row(int num_cols)
-{
-	// one tile in the first cell, the in the reamining cells there must be 3 cells per tile (numbers must be at least 2
-	// digits long)
-	return 1 + (num_cols - 1) / (min_number_len + 1);
-}
-
+// Callback is bool(), it is a template parameter so that the whole enumeration can be inlined.
+template<typename Callback>
 class PlaceRowTiles
 {
 public:
 	// Callback is called when tiles are placed in the row
 	// return value: true if visiting should be continued
-	using Callback = std::function<bool()>;
-
 	PlaceRowTiles(Board & board, int row, Callback const & callback):
 		board(board),
 		callback(callback),
@@ -679,9 +1213,20 @@ public:
 	// return value: true if visiting should be continued
 	bool run()
 	{
-		for (int num_tiles = 0; num_tiles <= max_num_tiles_in_row(board.num_cols); ++num_tiles)
+		// tiles can't be orthogonally adjacent
+		ColMask const adjacent_cols = board.get_row_tiles_cols(row - 1) | board.get_row_tiles_cols(row + 1);
+		for (ColMask const cols : board.get_row_tile_patterns(row))
 		{
-			bool const visit_more = try_placing_tiles(0, num_tiles);
+			if (cols & adjacent_cols)
+				continue;
+			for (ColMask rest = cols; rest != 0; rest &= rest - 1)
+			{
+				int const col = __builtin_ctz(rest);
+				board.push_row_tile(row, {(int8_t)col, board.get_cell_cells_for_displacement({row, col})});
+			}
+			bool const visit_more = callback();
+			for (ColMask rest = cols; rest != 0; rest &= rest - 1)
+				board.pop_row_tile(row);
 			if (!visit_more)
 				return false;
 		}
@@ -689,101 +1234,37 @@ public:
 	}
 
 private:
-	// It tries to place exactly remaining_tiles tiles, assuming that current number starts at start_col.
-	bool try_placing_tiles(int const start_col, int remaining_tiles)
-	{
-		if (remaining_tiles == 0)
-		{
-			// we placed all tiles, but the last numer's length needs to be checked
-			int const number_len = board.num_cols - start_col;
-			if (number_len >= min_number_len || number_len == 0)
-			{
-				bool const visit_more = callback();
-				return visit_more;
-			}
-		}
-		else
-		{
-			assert(remaining_tiles > 0);
-			// we need to place a tile
-			for (int end_col = start_col; end_col < board.num_cols; ++end_col)
-			{
-				int const number_len = end_col - start_col;
-				if ((number_len >= min_number_len || (number_len == 0 && end_col == 0))
-						&& !board.get_cell_is_highlighted({row, end_col}))
-				{
-					// check tiles in adjacent rows
-					bool is_ok = true;
-					for (int adjacent_row : {row - 1, row + 1})
-					{
-						if (adjacent_row >= 0 && adjacent_row < board.num_rows)
-						{
-							// is there a tile in {adjacent_row, col}?
-							std::vector<Board::Tile> const & adjacent_tiles = board.get_row_tiles(adjacent_row);
-							auto it = std::find_if(adjacent_tiles.begin(), adjacent_tiles.end(),
-									[end_col](Board::Tile const & tile) { return tile.col == end_col; });
-							if (it != adjacent_tiles.end())
-							{
-								is_ok = false;
-								break;
-							}
-						}
-					}
-					if (is_ok)
-					{
-						// we can place tile at {row, col}
-						// but only if cells_for_displacement set is not empty
-						std::bitset<4> cells_for_displacement;
-						Pos const tile_pos {row, end_col};
-						for (int i = 0; i < 4; ++i)
-						{
-							Pos const vec = orthogonal_dirs[i];
-							Pos const pos_for_displacement = tile_pos + vec;
-							if (board.is_on_board(pos_for_displacement) &&
-									!board.get_cell_is_highlighted(pos_for_displacement))
-							{
-								// we can displace to pos_for_displacement
-								cells_for_displacement.set(i);
-							}
-						}
-						if (cells_for_displacement.any())
-						{
-							// this is a valid tile position
-							board.get_row_tiles(row).push_back({(int8_t)end_col, cells_for_displacement});
-							bool const visit_more = try_placing_tiles(end_col + 1, remaining_tiles - 1);
-							board.get_row_tiles(row).pop_back();
-							if (!visit_more)
-								return false;
-						}
-					}
-				}
-			}
-		}
-		return true;
-	}
-
 	Board & board;
 	Callback const callback;
 	int const row;
 };
 
+// return value: the largest digit in the set (bit d is for digit d) or -1 if it is empty
+static int get_max_digit(uint16_t digits)
+{
+	return digits == 0 ? -1 : 31 - __builtin_clz(digits);
+}
+
+// Callback is bool() and ConstraintsCallback is bool(ColMask not_done_cols), they are template parameters so that
+// the whole enumeration can be inlined.
+template<typename Callback, typename ConstraintsCallback>
 class DisplaceTilesValue
 {
 public:
 	// Callback is called when for each tile in rows in [current_row-1; current_row+1], part of (or whole) its value is
 	// displaced to a cell in target_row.
 	// return value: true if visiting should be continued
-	using Callback = std::function<bool()>;
-
-	// Called often to check if constraints are satisfied, but numbers are only valid until first_not_done_col.
-	using ConstraintsCallback = std::function<bool(int first_not_done_col)>;
-
+	// ConstraintsCallback is called often to check if constraints are satisfied, but values of cells in not_done_cols
+	// (bit i is for column i) may still grow.
 	DisplaceTilesValue(Board & board, int target_row, Callback const & continuation_callback,
 			ConstraintsCallback const & constraints_callback):
 		board(board),
 		continuation_callback(continuation_callback),
 		constraints_callback(constraints_callback),
 		target_row(target_row),
+		allowed_digits(board.get_row_hint_digits(target_row).allowed_digits),
+		max_allowed_digit(get_max_digit(allowed_digits)),
+		num_displacements(0),
 		displacements()
 	{
 	}
@@ -795,29 +1276,43 @@ public:
 		{
 			if (source_row < 0 || source_row >= board.num_rows)
 				continue;
-			std::vector<Board::Tile> const & source_tiles = board.get_row_tiles(source_row);
+			Board::RowTiles const & source_tiles = board.get_row_tiles(source_row);
 			for (int source_tile_idx = 0; source_tile_idx < (int)source_tiles.size(); ++source_tile_idx)
 			{
 				Board::Tile const & tile = source_tiles[source_tile_idx];
 				Pos const tile_pos {source_row, tile.col};
+				if (board.get_cell_value(tile_pos) > get_capacity(tile_pos, tile.cells_for_displacement))
+				{
+					// the tile can't get rid of its value
+					return true;
+				}
 				for (int i = 0; i < 4; ++i)
 				{
-					if (tile.cells_for_displacement[i])
+					if (tile.cells_for_displacement & 1 << i)
 					{
 						Pos const vec = orthogonal_dirs[i];
 						Pos const pos_for_displacement = tile_pos + vec;
 						if (pos_for_displacement.row == target_row)
 						{
-							displacements.push_back({(int8_t)pos_for_displacement.col, (int8_t)source_row,
-									(int8_t)source_tile_idx, (int8_t)i});
+							assert(num_displacements < max_num_displacements);
+							displacements[num_displacements++] = {(int8_t)pos_for_displacement.col,
+									(int8_t)source_row, (int8_t)source_tile_idx, (int8_t)i, false, 0};
 						}
 					}
 				}
 			}
 		}
 
-		// sort by column of displacement in target_row, needed by constraints_callback
-		std::sort(displacements.begin(), displacements.end());
+		// sort by column of displacement in target_row, so that cells get their final values from left to right
+		std::sort(&displacements[0], &displacements[num_displacements]);
+		ColMask not_done_cols = 0;
+		for (int idx = num_displacements - 1; idx >= 0; --idx)
+		{
+			displacements[idx].is_last_to_cell = idx + 1 == num_displacements
+				|| displacements[idx + 1].pos_for_displacement_col != displacements[idx].pos_for_displacement_col;
+			not_done_cols |= (ColMask)((ColMask)1 << displacements[idx].pos_for_displacement_col);
+			displacements[idx].not_done_cols = not_done_cols;
+		}
 
 		return rec_displace(0);
 	}
@@ -829,6 +1324,10 @@ private:
 		int8_t source_row;
 		int8_t source_tile_idx;
 		int8_t cells_for_displacement_idx;
+		// true if it is the last displacement to its cell, so the cell's value is final after it
+		bool is_last_to_cell;
+		// columns of this and the following displacements
+		ColMask not_done_cols;
 
 		bool operator<(Displacement const & other) const
 		{
@@ -836,9 +1335,128 @@ private:
 		}
 	};
 
+	// Upper bound on how much can still be displaced to a cell (not a tile), as its final value is at most the largest
+	// digit allowed in its row.
+	int get_headroom(Pos const pos) const
+	{
+		int value = board.get_cell_value(pos);
+		if (value < 0)
+		{
+			// row of the cell has no region assignments yet
+			int const region_value = board.get_region_value(board.get_cell_region(pos));
+			value = region_value >= 0 ? region_value : 1;
+		}
+		int const max_digit = pos.row == target_row
+			? max_allowed_digit
+			: get_max_digit(board.get_row_hint_digits(pos.row).allowed_digits);
+		return std::max(0, max_digit - value);
+	}
+
+	// Upper bound on how much a tile can still displace to its cells_for_displacement.
+	int get_capacity(Pos const tile_pos, uint8_t cells_for_displacement) const
+	{
+		int capacity = 0;
+		for (; cells_for_displacement != 0; cells_for_displacement &= cells_for_displacement - 1)
+			capacity += get_headroom(tile_pos + orthogonal_dirs[__builtin_ctz(cells_for_displacement)]);
+		return capacity;
+	}
+
+	// Upper bound on how much is displaced to the cell of displacement_idx by it and the following displacements.
+	int get_incoming(int displacement_idx) const
+	{
+		int const col = displacements[displacement_idx].pos_for_displacement_col;
+		int incoming = 0;
+		for (int idx = displacement_idx; idx < num_displacements && displacements[idx].pos_for_displacement_col == col;
+				++idx)
+		{
+			int const source_row = displacements[idx].source_row;
+			Board::Tile const & tile = board.get_row_tiles(source_row)[displacements[idx].source_tile_idx];
+			incoming += board.get_cell_value({source_row, tile.col});
+		}
+		return incoming;
+	}
+
+	/*
+	 * Diagonally adjacent tiles T1 and T2 share two cells C1 and C2, T1 is horizontally adjacent to C1 and vertically to
+	 * C2, and the other way round for T2. Displacing a unit more along T1 -> C1 and T2 -> C2 and a unit less along
+	 * T1 -> C2 and T2 -> C1 gives the same grid, so the same solution would be found for many displacements. Only the
+	 * ones with the lowest total of horizontal displacements are needed, and in them T1 -> C1 or T2 -> C2 is 0 for each
+	 * such pair of tiles. This is enforced when the first of the two rows is processed: if a tile in target_row
+	 * displaces horizontally, the horizontal displacement of the diagonal tile in the other row is removed from its
+	 * cells_for_displacement.
+	 */
+	struct CycleDisplacement
+	{
+		int8_t row;
+		int8_t tile_idx;
+		int8_t cells_for_displacement_idx;
+	};
+
+	// Finds horizontal displacements (not done yet) of tiles diagonally adjacent to the tile at tile_pos in target_row,
+	// which share a cell with its horizontal displacement in direction i.
+	// return value: number of displacements found
+	int find_cycle_displacements(Pos const tile_pos, int const i, CycleDisplacement (&cycle_displacements)[2]) const
+	{
+		Pos const vec = orthogonal_dirs[i];
+		if (vec.row != 0)
+			return 0;
+		int num_cycle_displacements = 0;
+		for (Pos const vertical_vec : {vec_up, vec_down})
+		{
+			Pos const diagonal_tile_pos = tile_pos + vec + vertical_vec;
+			if (!board.is_on_board(diagonal_tile_pos))
+				continue;
+			ColMask const cols = board.get_row_tiles_cols(diagonal_tile_pos.row);
+			if (!(cols >> diagonal_tile_pos.col & 1))
+				continue;
+			// tiles are ordered by column
+			int const tile_idx = __builtin_popcount(cols & ((1u << diagonal_tile_pos.col) - 1));
+			Board::Tile const & tile = board.get_row_tiles(diagonal_tile_pos.row)[tile_idx];
+			assert(tile.col == diagonal_tile_pos.col);
+			// displacement of the diagonal tile in the opposite direction, to the cell vertically adjacent to us
+			int const opposite_i = i ^ 2;
+			if (tile.cells_for_displacement & 1 << opposite_i)
+			{
+				cycle_displacements[num_cycle_displacements++] = {(int8_t)diagonal_tile_pos.row, (int8_t)tile_idx,
+						(int8_t)opposite_i};
+			}
+		}
+		return num_cycle_displacements;
+	}
+
+	// return value: false if a tile can't get rid of its value without the blocked displacements
+	bool block_cycle_displacements(CycleDisplacement const (&cycle_displacements)[2], int num_cycle_displacements)
+	{
+		bool is_ok = true;
+		for (int idx = 0; idx < num_cycle_displacements; ++idx)
+		{
+			CycleDisplacement const & cycle_displacement = cycle_displacements[idx];
+			Board::Tile const & tile = board.get_row_tiles(cycle_displacement.row)[cycle_displacement.tile_idx];
+			uint8_t const cells_for_displacement =
+				tile.cells_for_displacement & ~(1 << cycle_displacement.cells_for_displacement_idx);
+			board.set_tile_cells_for_displacement(cycle_displacement.row, cycle_displacement.tile_idx,
+					cells_for_displacement);
+			Pos const tile_pos {cycle_displacement.row, tile.col};
+			if (board.get_cell_value(tile_pos) > get_capacity(tile_pos, cells_for_displacement))
+				is_ok = false;
+		}
+		return is_ok;
+	}
+
+	void unblock_cycle_displacements(CycleDisplacement const (&cycle_displacements)[2], int num_cycle_displacements)
+	{
+		for (int idx = 0; idx < num_cycle_displacements; ++idx)
+		{
+			CycleDisplacement const & cycle_displacement = cycle_displacements[idx];
+			Board::Tile const & tile = board.get_row_tiles(cycle_displacement.row)[cycle_displacement.tile_idx];
+			board.set_tile_cells_for_displacement(cycle_displacement.row, cycle_displacement.tile_idx,
+					tile.cells_for_displacement | 1 << cycle_displacement.cells_for_displacement_idx);
+		}
+	}
+
 	bool rec_displace(int const displacement_idx)
 	{
-		if (displacement_idx >= (int)displacements.size())
+		if (displacement_idx >= num_displacements)
 		{
 			// we have a proper displacement
 			bool const visit_more = continuation_callback();
@@ -846,19 +1464,16 @@ private:
 		}
 		else
 		{
+			if (!constraints_callback(displacements[displacement_idx].not_done_cols))
 			{
-				int const first_not_done_col = displacements[displacement_idx].pos_for_displacement_col;
-				if (!constraints_callback(first_not_done_col))
-				{
-					// prune this search branch early
-					return true;
-				}
+				// prune this search branch early
+				return true;
 			}
 
 			int const source_tile_idx = displacements[displacement_idx].source_tile_idx;
 			int const source_row = displacements[displacement_idx].source_row;
-			std::vector<Board::Tile> & source_tiles = board.get_row_tiles(source_row);
-			Board::Tile & tile = source_tiles[source_tile_idx];
+			Board::Tile const & tile = board.get_row_tiles(source_row)[source_tile_idx];
+			uint8_t const orig_cells_for_displacement = tile.cells_for_displacement;
 			Pos const tile_pos {source_row, tile.col};
 			int const i = displacements[displacement_idx].cells_for_displacement_idx;
 			Pos const vec = orthogonal_dirs[i];
@@ -866,33 +1481,53 @@ private:
 			assert(pos_for_displacement.row == target_row);
 
 			int const orig_pos_for_displacement_value = board.get_cell_value(pos_for_displacement);
-			int const max_addition = 9 - orig_pos_for_displacement_value;
-			assert(max_addition >= 0);
-			assert(max_addition <= 8);
+			assert(orig_pos_for_displacement_value >= 1 && orig_pos_for_displacement_value <= 9);
+			// values of cells only grow with displacements
+			int const max_addition = max_allowed_digit - orig_pos_for_displacement_value;
+			// how much can be displaced to the cell after this displacement
+			int const rest_incoming = displacements[displacement_idx].is_last_to_cell
+				? 0
+				: get_incoming(displacement_idx + 1);
 
 			int const orig_tile_value = board.get_cell_value(tile_pos);
 
-			assert(tile.cells_for_displacement[i]);
+			assert(orig_cells_for_displacement & 1 << i);
 			// remote from cells_for_displacement
-			tile.cells_for_displacement.reset(i);
+			board.set_tile_cells_for_displacement(source_row, source_tile_idx, orig_cells_for_displacement & ~(1 << i));
+
+			// horizontal displacements of diagonal tiles which are blocked when this one is not 0
+			CycleDisplacement cycle_displacements[2];
+			int const num_cycle_displacements = source_row == target_row
+				? find_cycle_displacements(tile_pos, i, cycle_displacements)
+				: 0;
 
 			bool visit_more = true;
-			int add = tile.cells_for_displacement.any()
-				? 0                // can displace values <= orig_tile_value
-				: orig_tile_value; // can displace exactly orig_tile_value
+			// what is not displaced now must fit into the remaining cells_for_displacement (exactly orig_tile_value
+			// must be displaced if there are none)
+			int add = std::max(0, orig_tile_value - get_capacity(tile_pos, tile.cells_for_displacement));
 			for (; add <= orig_tile_value && add <= max_addition; ++add)
 			{
+				// the cell must be able to end up with an allowed digit
+				if (!(allowed_digits >> (orig_pos_for_displacement_value + add) & ((2 << rest_incoming) - 1)))
+					continue;
+				if (add > 0 && !block_cycle_displacements(cycle_displacements, num_cycle_displacements))
+				{
+					unblock_cycle_displacements(cycle_displacements, num_cycle_displacements);
+					continue;
+				}
 				board.set_cell_value(pos_for_displacement, orig_pos_for_displacement_value + add);
 				board.set_cell_value(tile_pos, orig_tile_value - add);
 				visit_more = rec_displace(displacement_idx + 1);
 				board.set_cell_value(tile_pos, orig_tile_value);
 				board.set_cell_value(pos_for_displacement, orig_pos_for_displacement_value);
+				if (add > 0)
+					unblock_cycle_displacements(cycle_displacements, num_cycle_displacements);
 				if (!visit_more)
 					break;
 			}
 
 			// add back to cells_for_displacement
-			tile.cells_for_displacement.set(i);
+			board.set_tile_cells_for_displacement(source_row, source_tile_idx, orig_cells_for_displacement);
 			return visit_more;
 		}
 	}
@@ -901,9 +1536,17 @@ private:
 	Callback const continuation_callback;
 	ConstraintsCallback const constraints_callback;
 	int const target_row;
-	std::vector<Displacement> displacements;
+	// Cells that get displacements are parts of numbers in target_row, so they can only end up with allowed digits.
+	uint16_t const allowed_digits;
+	int const max_allowed_digit;
+	// Tiles in target_row can displace to left and right, the ones in rows above and below only to target_row.
+	static constexpr int max_num_displacements = 4 * Board::max_num_tiles_per_row;
+	int num_displacements;
+	Displacement displacements[max_num_displacements];
 };
 
+// Callback is bool(), it is a template parameter so that the whole enumeration can be inlined.
+template<typename Callback>
 class RowProcessor
 {
 public:
@@ -911,12 +1554,12 @@ public:
 	// [current_row-1; current_row+1], same for tiles. Displacements are only done to current_row. Numbers are added to
 	// the global set and they satisfy row hint.
 	// return value: true if visiting should be continued
-	using Callback = std::function<bool()>;
-
 	RowProcessor(Board & board, int current_row, Callback const & callback):
 		board(board),
 		callback(callback),
-		current_row(current_row)
+		current_row(current_row),
+		has_rejected_duplicate(false),
+		num_steps(0)
 	{
 	}
 
@@ -927,6 +1570,19 @@ public:
 		return perform_row_region_assignments(current_row - 1);
 	}
 
+	// Returns true if a number was rejected because it was already in the grid, so that the result of run() depends on
+	// numbers outside of the neighborhood of current_row.
+	bool get_has_rejected_duplicate() const
+	{
+		return has_rejected_duplicate;
+	}
+
+	// Number of displacements checked so far, a measure of work done by run().
+	uint64_t get_num_steps() const
+	{
+		return num_steps;
+	}
+
 private:
 	bool perform_row_region_assignments(int const row)
 	{
@@ -940,7 +1596,7 @@ private:
 			// perform region assignments in row
 			assert(!board.get_row_has_region_assignments(row));
 			board.set_row_has_region_assignments(row, true);
-			AssignRowRegionsValue work(board, row, std::bind(&RowProcessor::done_row_region_assignments, this, row));
+			AssignRowRegionsValue work(board, row, [this, row]() { return done_row_region_assignments(row); });
 			bool const visit_more = work.run();
 			board.set_row_has_region_assignments(row, false);
 			return visit_more;
@@ -983,7 +1639,7 @@ private:
 			// perform tiles placement in row
 			assert(!board.get_row_has_tiles_placement(row));
 			board.set_row_has_tiles_placement(row, true);
-			PlaceRowTiles work(board, row, std::bind(&RowProcessor::done_row_tiles_placement, this, row));
+			PlaceRowTiles work(board, row, [this, row]() { return done_row_tiles_placement(row); });
 			bool const visit_more = work.run();
 			board.set_row_has_tiles_placement(row, false);
 			return visit_more;
@@ -1005,15 +1661,17 @@ private:
 	bool perform_displacements_to_current_row()
 	{
 		DisplaceTilesValue work(board, current_row,
-				std::bind(&RowProcessor::check_row_hints_and_call_back, this),
-				std::bind(&RowProcessor::constraints_callback, this, _1));
+				[this]() { return check_row_hints_and_call_back(); },
+				[this](ColMask not_done_cols) { return constraints_callback(not_done_cols); });
 		bool const visit_more = work.run();
 		return visit_more;
 	}
 
-	bool check_row_hints(std::vector<uint64_t> & added_numbers, int first_not_done_col)
+	// Numbers checked are left in the global set, callers roll it back. Values of cells in not_done_cols (bit i is
+	// for column i) may still grow, numbers with such cells are only checked for being feasible.
+	bool check_row_hints(ColMask not_done_cols)
 	{
-		std::vector<Board::Tile> const & tiles = board.get_row_tiles(current_row);
+		Board::RowTiles const & tiles = board.get_row_tiles(current_row);
 		bool is_ok = true;
 
 		// collect numbers in row, check for duplicates in grid, check hints
@@ -1023,24 +1681,13 @@ private:
 			// consider number ending at current tile (it)
 			int const start_col = it == tiles.begin() ? 0 : (it - 1)->col + 1;
 			int const end_col = it == tiles.end() ? board.num_cols : it->col;
-			if (end_col > first_not_done_col)
-			{
-				// number is not fixed yet (displacements not done)
-				break;
-			}
-			// number is fixed, check it
 			if (start_col < end_col)
 			{
-				uint64_t number = 0;
-				for (int col = start_col; col < end_col; ++col)
-				{
-					number = number * 10 + board.get_cell_value({current_row, col});
-				}
-				auto p = board.numbers_in_grid.insert(number);
-				if (p.second)
+				ColMask const number_cols = (ColMask)(((uint64_t)1 << end_col) - ((uint64_t)1 << start_col));
+				if (not_done_cols & number_cols)
 				{
-					added_numbers.push_back(number);
-					if (!board.call_row_hints_fun(current_row, number))
+					// number is not fixed yet (displacements not done)
+					if (!check_partial_number(start_col, end_col, not_done_cols))
 					{
 						is_ok = false;
 						break;
@@ -1048,9 +1695,27 @@ private:
 				}
 				else
 				{
-					// duplicate number
-					is_ok = false;
-					break;
+					// number is fixed, check it
+					Number number = 0;
+					for (int col = start_col; col < end_col; ++col)
+					{
+						number = number * 10 + board.get_cell_value({current_row, col});
+					}
+					if (board.numbers_in_grid.insert(number))
+					{
+						if (!board.call_row_hints_fun(current_row, number))
+						{
+							is_ok = false;
+							break;
+						}
+					}
+					else
+					{
+						// duplicate number
+						has_rejected_duplicate = true;
+						is_ok = false;
+						break;
+					}
 				}
 			}
 
@@ -1062,24 +1727,44 @@ private:
 		return is_ok;
 	}
 
-	bool constraints_callback(int first_not_done_col)
+	// Checks if the number in [start_col; end_col) of current_row can still satisfy row's hint, given its digits which
+	// are not in not_done_cols.
+	bool check_partial_number(int start_col, int end_col, ColMask not_done_cols) const
 	{
-		std::vector<uint64_t> added_numbers;
-		bool const is_ok = check_row_hints(added_numbers, first_not_done_col);
-
-		for (uint64_t number : added_numbers)
+		HintDigits const & hint_digits = board.get_row_hint_digits(current_row);
+		int8_t digits[max_num_cols];
+		uint32_t fixed_digits = 0;
+		int digit_count[10] = {};
+		for (int col = start_col; col < end_col; ++col)
 		{
-			int const num_erased = board.numbers_in_grid.erase(number);
-			assert(num_erased == 1);
+			int const digit = board.get_cell_value({current_row, col});
+			digits[col - start_col] = digit;
+			if (!(not_done_cols >> col & 1))
+			{
+				fixed_digits |= (uint32_t)1 << (col - start_col);
+				if (!(hint_digits.allowed_digits >> digit & 1)
+						|| ++digit_count[digit] > hint_digits.max_digit_count[digit])
+					return false;
+			}
 		}
+		return can_satisfy_hint(board.get_row_hints_fun(current_row), board.get_row_hints_arg(current_row), digits,
+				end_col - start_col, fixed_digits);
+	}
 
+	bool constraints_callback(ColMask not_done_cols)
+	{
+		++num_steps;
+		int const numbers_mark = board.numbers_in_grid.size();
+		bool const is_ok = check_row_hints(not_done_cols);
+		board.numbers_in_grid.rollback(numbers_mark);
 		return is_ok;
 	}
 
 	bool check_row_hints_and_call_back()
 	{
-		std::vector<uint64_t> added_numbers;
-		bool const is_ok = check_row_hints(added_numbers, board.num_cols);
+		++num_steps;
+		int const numbers_mark = board.numbers_in_grid.size();
+		bool const is_ok = check_row_hints(0);
 
 		bool visit_more = true;
 		if (is_ok)
@@ -1096,191 +1781,2693 @@ private:
 			//	<< ", board:\n" << board << std::endl);
 		}
 
-		for (uint64_t number : added_numbers)
-		{
-			int const num_erased = board.numbers_in_grid.erase(number);
-			assert(num_erased == 1);
-		}
-
+		board.numbers_in_grid.rollback(numbers_mark);
 		return visit_more;
 	}
 
 	Board & board;
 	Callback const callback;
 	int const current_row;
+	bool has_rejected_duplicate;
+	uint64_t num_steps;
 };
 
-class NumberCrossSolver
+/*
+ * Records states of the board in which RowProcessor for current_row calls back (completions), so that they can be
+ * replayed later without redoing the enumeration. A completion is stored as a compact delta: cell values and tiles of
+ * rows in [current_row-1; current_row+1], values of regions in these rows and numbers of current_row. Rows flags are the
+ * same for all completions: every row in [current_row-1; current_row+1] has region assignments and tiles placement.
+ * Nothing else is changed by RowProcessor, so completions can be replayed on any board with the same neighborhood of
+ * current_row (see Board::compute_row_neighborhood_key()), as long as their numbers are not in its grid yet.
+ */
+class RowCompletions
 {
 public:
-	// Callback is called when grid is solved.
-	using Callback = std::function<void()>;
+	// Completions beyond this count are not recorded (too much memory), see is_complete().
+	static constexpr int max_num_completions = 1 << 16;
+
+	RowCompletions():
+		current_row(-1),
+		first_row(0),
+		last_row(-1),
+		regions(0),
+		base(),
+		data(),
+		numbers(),
+		entries(),
+		num_dropped(0),
+		is_loaded(false)
+	{
+	}
 
-	NumberCrossSolver(Board & board, Callback const & callback):
-		board(board),
-		callback(callback),
-		rec_level(0),
-		processed_boards()
+	// Starts recording completions of current_row, the board is in the state before RowProcessor runs.
+	void begin(Board const & board, int current_row)
 	{
+		clear();
+		this->current_row = current_row;
+		first_row = std::max(current_row - 1, 0);
+		last_row = std::min(current_row + 1, board.num_rows - 1);
+		regions = 0;
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			for (int col = 0; col < board.num_cols; ++col)
+				regions |= (uint32_t)1 << board.get_cell_region({row, col});
+		}
+		write_state(board, base);
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			base.push_back(board.get_row_has_region_assignments(row));
+			base.push_back(board.get_row_has_tiles_placement(row));
+		}
 	}
 
-	void run()
+	// Forgets recorded completions.
+	void clear()
 	{
-		rec_solve();
+		current_row = -1;
+		base.clear();
+		data.clear();
+		numbers.clear();
+		entries.clear();
+		num_dropped = 0;
+		is_loaded = false;
 	}
 
-private:
-	void rec_solve()
+	// Called from RowProcessor's callback.
+	void capture(Board const & board)
 	{
-		if (rec_level <= processed_boards_max_rec_level)
+		if ((int)entries.size() >= max_num_completions)
 		{
-			if (processed_boards.find(board) != processed_boards.end())
-			{
-				DBG(std::cout << __func__
-					<< " rec_level: " << rec_level
-					<< " board already processed, skipping" << std::endl);
-				return;
-			}
+			++num_dropped;
+			return;
 		}
+		entries.push_back({(int)data.size(), (int)numbers.size()});
+		write_state(board, data);
+		board.for_each_row_number(current_row, [this](Number number) { numbers.push_back(number); });
+	}
 
-		// Pick the most promising row that has not been processed yet. If no such row then print answer.
-		// Row is better if it has lower branching degree, i.e. lower number of direct calls to rec_solve().
+	// true if all completions were recorded
+	bool is_complete() const
+	{
+		return num_dropped == 0;
+	}
 
-		// Prepare a vector of rows to check, in a heuristic order from the lowest branching degree.
-		std::vector<std::pair<int, int>> rows_to_check;
-		rows_to_check.reserve(board.num_rows);
-		for (int row_to_check = 0; row_to_check < board.num_rows; ++row_to_check)
+	int get_current_row() const
+	{
+		return current_row;
+	}
+
+	// true if the completions come from load(), so they may have been captured on another board, in another order
+	bool get_is_loaded() const
+	{
+		return is_loaded;
+	}
+
+	int size() const
+	{
+		return (int)entries.size();
+	}
+
+	// true if no number of the completion is in the grid of the board
+	bool has_new_numbers(Board const & board, int idx) const
+	{
+		assert(idx >= 0 && idx < size());
+		NumberSet<Board::max_num_numbers> const & numbers_in_grid = board.numbers_in_grid;
+		for (int i = entries[idx].numbers_offset; i < numbers_end(idx); ++i)
 		{
-			if (!board.get_row_is_processed(row_to_check))
-			{
-				// Compute number of different regions that don't have their value set yet. Check each row in
-				// [row_to_check-1; row_to_check+1].
-				std::bitset<max_num_regions> regions_without_value;
-				for (int row = row_to_check - 1; row <= row_to_check + 1; ++row)
-				{
-					if (row >= 0 && row < board.num_rows)
-					{
-						for (int col = 0; col < board.num_cols; ++col)
-						{
-							int const region_idx = board.get_cell_region({row, col});
-							if (board.get_region_value(region_idx) == -1)
-								regions_without_value.set(region_idx);
-						}
-					}
-				}
+			if (std::find(numbers_in_grid.begin(), numbers_in_grid.end(), numbers[i]) != numbers_in_grid.end())
+				return false;
+		}
+		return true;
+	}
 
-				int const order_val = regions_without_value.count();
-				rows_to_check.emplace_back(order_val, row_to_check);
+	// Puts the board in the state of the completion, the board must have the same neighborhood of current_row as the
+	// one passed to begin().
+	// return value: false if a number of the completion is already in the grid, the board is left unchanged then
+	bool apply(Board & board, int idx) const
+	{
+		assert(idx >= 0 && idx < size());
+		int const numbers_mark = board.numbers_in_grid.size();
+		for (int i = entries[idx].numbers_offset; i < numbers_end(idx); ++i)
+		{
+			if (!board.numbers_in_grid.insert(numbers[i]))
+			{
+				board.numbers_in_grid.rollback(numbers_mark);
+				return false;
 			}
 		}
-		std::sort(rows_to_check.begin(), rows_to_check.end());
+		read_state(board, data, entries[idx].data_offset);
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			board.set_row_has_region_assignments(row, true);
+			board.set_row_has_tiles_placement(row, true);
+		}
+		return true;
+	}
 
-		// find best row
-		int best_row = -1;
-		uint32_t best_row_degree = std::numeric_limits<uint32_t>::max();
-		for (auto const & p : rows_to_check)
+	// Reverts apply(), numbers inserted since must have been rolled back.
+	void undo(Board & board, int idx) const
+	{
+		assert(idx >= 0 && idx < size());
+		int const num_numbers = numbers_end(idx) - entries[idx].numbers_offset;
+		assert(board.numbers_in_grid.size() >= num_numbers);
+		assert(std::equal(&numbers[entries[idx].numbers_offset], &numbers[0] + numbers_end(idx),
+				board.numbers_in_grid.end() - num_numbers));
+		board.numbers_in_grid.rollback(board.numbers_in_grid.size() - num_numbers);
+		int const flags_offset = read_state(board, base, 0);
+		for (int row = first_row; row <= last_row; ++row)
 		{
-			int const current_row = p.second;
+			board.set_row_has_region_assignments(row, base[flags_offset + 2 * (row - first_row)]);
+			board.set_row_has_tiles_placement(row, base[flags_offset + 2 * (row - first_row) + 1]);
+		}
+	}
 
-			DBG2(std::cout << __func__
-				<< " rec_level: " << rec_level
-				<< " start checking degree of current_row: " << current_row
-				<< " best_row_degree: " << best_row_degree
-				<< " best_row: " << best_row
-				<< std::endl);
+	// Size in bytes of the record written by save().
+	size_t get_record_size() const
+	{
+		return sizeof(RecordHeader) + base.size() + data.size() + numbers.size() * sizeof(Number)
+			+ entries.size() * sizeof(Entry);
+	}
 
-			uint32_t current_row_degree = 0;
-			RowProcessor work(board, current_row, [&]()
-			{
-				++current_row_degree;
+	// Writes the completions to record, which has get_record_size() bytes.
+	void save(char * record) const
+	{
+		RecordHeader const header = {current_row, first_row, last_row, regions, num_dropped, (int)base.size(),
+			(int)data.size(), (int)numbers.size(), (int)entries.size()};
+		std::memcpy(record, &header, sizeof(header));
+		record = save_items(base, record + sizeof(header));
+		record = save_items(data, record);
+		record = save_items(numbers, record);
+		save_items(entries, record);
+	}
 
-				DBG2(std::cout << "[degree testing callback]"
-					<< " rec_level: " << rec_level
-					<< " degree of current_row: " << current_row << " is at the moment: " << current_row_degree
-					<< " best_row_degree: " << best_row_degree
-					<< " best_row: " << best_row
-					<< std::endl);
-				DBG3(std::cout << board << std::endl);
+	// Replaces the completions with the ones save() wrote to record. Memory of the vectors is reused, so this does not
+	// allocate once they have grown to the size of the record.
+	void load(char const * record)
+	{
+		RecordHeader header;
+		std::memcpy(&header, record, sizeof(header));
+		current_row = header.current_row;
+		first_row = header.first_row;
+		last_row = header.last_row;
+		regions = header.regions;
+		num_dropped = header.num_dropped;
+		is_loaded = true;
+		record = load_items(record + sizeof(header), header.base_size, base);
+		record = load_items(record, header.data_size, data);
+		record = load_items(record, header.numbers_size, numbers);
+		load_items(record, header.entries_size, entries);
+	}
 
-				return current_row_degree < best_row_degree;
-			});
-			work.run();
+private:
+	struct Entry
+	{
+		int data_offset;
+		int numbers_offset;
+	};
 
-			if (current_row_degree < best_row_degree)
-			{
-				best_row_degree = current_row_degree;
-				best_row = current_row;
-			}
+	// Head of records written by save(), followed by items of base, data, numbers and entries.
+	struct RecordHeader
+	{
+		int current_row;
+		int first_row;
+		int last_row;
+		uint32_t regions;
+		int num_dropped;
+		int base_size;
+		int data_size;
+		int numbers_size;
+		int entries_size;
+	};
 
-			DBG(std::cout << __func__
-				<< " rec_level: " << rec_level
-				<< " found degree of current_row: " << current_row << " to be: " << current_row_degree
-				<< " best_row_degree: " << best_row_degree
-				<< " best_row: " << best_row
-				<< std::endl);
+	template <typename T>
+	static char * save_items(std::vector<T> const & items, char * record)
+	{
+		if (!items.empty())
+			std::memcpy(record, items.data(), items.size() * sizeof(T));
+		return record + items.size() * sizeof(T);
+	}
 
-			if (best_row_degree == 0)
-				break;
-		}
+	// Reads size items into items, which keeps its capacity if it is large enough.
+	template <typename T>
+	static char const * load_items(char const * record, int size, std::vector<T> & items)
+	{
+		items.resize(size);
+		if (size != 0)
+			std::memcpy(items.data(), record, size * sizeof(T));
+		return record + size * sizeof(T);
+	}
 
-		if (best_row_degree == std::numeric_limits<uint32_t>::max())
-		{
-			// all rows were processed
-			callback();
-		}
-		else if (best_row_degree > 0)
-		{
-			DBG(std::cout << __func__
-				<< " rec_level: " << rec_level
-				<< " start processing best_row: " << best_row
-				<< " with degree: " << best_row_degree << std::endl);
+	int numbers_end(int idx) const
+	{
+		return idx + 1 < size() ? entries[idx + 1].numbers_offset : (int)numbers.size();
+	}
 
-			// process best row, calling us recursively
-			assert(!board.get_row_is_processed(best_row));
-			board.set_row_is_processed(best_row, true);
-			RowProcessor work(board, best_row, [this]()
+	// Layout: cell values and tiles (count, then col and cells_for_displacement of each) of rows in
+	// [first_row; last_row], then values of their regions.
+	void write_state(Board const & board, std::vector<int8_t> & out) const
+	{
+		for (int row = first_row; row <= last_row; ++row)
+		{
+			for (int col = 0; col < board.num_cols; ++col)
+				out.push_back(board.get_cell_value({row, col}));
+			Board::RowTiles const & tiles = board.get_row_tiles(row);
+			out.push_back((int8_t)tiles.size());
+			for (Board::Tile const & tile : tiles)
 			{
-				++rec_level;
-				rec_solve();
-				--rec_level;
-				return true;
-			});
-			work.run();
-			board.set_row_is_processed(best_row, false);
+				out.push_back(tile.col);
+				out.push_back((int8_t)tile.cells_for_displacement);
+			}
 		}
+		for (uint32_t rest = regions; rest != 0; rest &= rest - 1)
+			out.push_back(board.get_region_value(__builtin_ctz(rest)));
+	}
 
-		if (rec_level <= processed_boards_max_rec_level)
+	// return value: offset just past the state read
+	int read_state(Board & board, std::vector<int8_t> const & in, int offset) const
+	{
+		for (int row = first_row; row <= last_row; ++row)
 		{
-			auto p = processed_boards.insert(board);
-			// It should get inserted, otherwise it means we did a rec_solve() that led to the same board.
-			assert(p.second);
+			for (int col = 0; col < board.num_cols; ++col)
+				board.set_cell_value({row, col}, in[offset++]);
+			while (!board.get_row_tiles(row).empty())
+				board.pop_row_tile(row);
+			int const num_tiles = in[offset++];
+			for (int tile_idx = 0; tile_idx < num_tiles; ++tile_idx)
+			{
+				int8_t const col = in[offset++];
+				board.push_row_tile(row, {col, (uint8_t)in[offset++]});
+			}
 		}
+		for (uint32_t rest = regions; rest != 0; rest &= rest - 1)
+			board.set_region_value(__builtin_ctz(rest), in[offset++]);
+		return offset;
 	}
 
-	static constexpr int processed_boards_max_rec_level = 5;
-
-	Board & board;
-	Callback const callback;
-	int rec_level;
-	std::unordered_set<Board> processed_boards;
+	int current_row;
+	int first_row;
+	int last_row;
+	uint32_t regions; // regions of rows in [first_row; last_row], i'th bit is for region i
+	std::vector<int8_t> base; // state passed to begin() followed by its rows flags
+	std::vector<int8_t> data; // states of completions
+	std::vector<Number> numbers; // numbers of current_row in completions
+	std::vector<Entry> entries;
+	int num_dropped;
+	bool is_loaded;
 };
 
-int main()
+/*
+ * Completions of rows recorded by NumberCrossSolver::find_best_row(), keyed by neighborhoods of their rows
+ * (Board::compute_row_neighborhood_key()), so that a row coming back with the same neighborhood in another branch is
+ * replayed instead of processed again. Only completions which don't depend on numbers elsewhere in the grid are stored
+ * (no number was rejected as a duplicate), their numbers are checked against the grid when they are replayed.
+ *
+ * Everything is allocated by the constructor, so that the search does not allocate: entries come from a fixed pool,
+ * keys are looked up in an open addressing index and completions are stored as records (RowCompletions::save())
+ * appended to a fixed-size arena. The least recently used entries are evicted when the pool is empty or the arena is
+ * full; in the latter case, they are evicted until a quarter of the arena is free, then the remaining records are
+ * moved to its start.
+ */
+class RowCompletionsCache
 {
-#ifndef NDEBUG
-	std::cout << "Running in debug config" << std::endl;
-#else
-	std::cout << "Running in release config" << std::endl;
-#endif
+public:
+	struct Stats
+	{
+		uint64_t lookups = 0;
+		uint64_t hits = 0;
+		uint64_t inserts = 0;
+		uint64_t evictions = 0;
+	};
 
-	Board board = read_data(std::cin);
-	board.compute_region_neighbors();
+	static constexpr int default_arena_size_log2 = 25;
+
+	explicit RowCompletionsCache(int arena_size_log2 = default_arena_size_log2):
+		arena_size((size_t)1 << arena_size_log2),
+		max_num_entries(1 << (arena_size_log2 - record_size_log2)),
+		index_mask(2 * max_num_entries - 1),
+		arena(new char[arena_size]),
+		arena_end(0),
+		live_size(0),
+		entries(new Entry[max_num_entries]),
+		free_entries(new int[max_num_entries]),
+		num_free_entries(max_num_entries),
+		index(new int[index_mask + 1]),
+		compacted_entries(new int[max_num_entries]),
+		most_recent(-1),
+		least_recent(-1),
+		stats()
+	{
+		assert(arena_size_log2 > record_size_log2 && arena_size_log2 < 31);
+		for (int i = 0; i < max_num_entries; ++i)
+			free_entries[i] = i;
+		for (int i = 0; i <= index_mask; ++i)
+			index[i] = -1;
+	}
+
+	// Replaces completions with the ones stored under key.
+	// return value: false if key is not stored, completions are left unchanged then
+	bool find(uint64_t key, RowCompletions & completions)
+	{
+		++stats.lookups;
+		int const entry_idx = index[find_pos(key)];
+		if (entry_idx == -1)
+			return false;
+		++stats.hits;
+		completions.load(&arena[entries[entry_idx].offset]);
+		// move to the front, which is the most recently used entry
+		unlink(entry_idx);
+		link_front(entry_idx);
+		return true;
+	}
+
+	// Stores a copy of completions under key, which must not be stored yet.
+	void insert(uint64_t key, RowCompletions const & completions)
+	{
+		assert(index[find_pos(key)] == -1);
+		size_t const size = completions.get_record_size();
+		if (size > arena_size / 2)
+			return;
+		++stats.inserts;
+		if (num_free_entries == 0)
+			evict();
+		if (arena_end + size > arena_size)
+		{
+			while (live_size + size > arena_size / 4 * 3)
+				evict();
+			compact();
+		}
+		int const entry_idx = free_entries[--num_free_entries];
+		Entry & entry = entries[entry_idx];
+		entry.key = key;
+		entry.offset = arena_end;
+		entry.size = size;
+		completions.save(&arena[arena_end]);
+		arena_end += size;
+		live_size += size;
+		link_front(entry_idx);
+		// evictions may have moved keys in index, so the position is looked up after them
+		index[find_pos(key)] = entry_idx;
+	}
+
+	Stats const & get_stats() const
+	{
+		return stats;
+	}
+
+private:
+	// Records are expected to take this many bytes on average, which sets the number of entries for the arena size.
+	static constexpr int record_size_log2 = 9;
+
+	struct Entry
+	{
+		uint64_t key;
+		size_t offset; // of the record in arena
+		size_t size; // of the record
+		int newer; // next entry toward most_recent, -1 for it
+		int older; // next entry toward least_recent, -1 for it
+	};
+
+	// Position of key in index, or of the empty position which ends its probe sequence if it is not there.
+	int find_pos(uint64_t key) const
+	{
+		int pos = get_home_pos(key);
+		while (index[pos] != -1 && entries[index[pos]].key != key)
+			pos = (pos + 1) & index_mask;
+		return pos;
+	}
+
+	int get_home_pos(uint64_t key) const
+	{
+		return (int)((key >> 32 ^ key) & index_mask);
+	}
+
+	void link_front(int entry_idx)
+	{
+		entries[entry_idx].newer = -1;
+		entries[entry_idx].older = most_recent;
+		if (most_recent != -1)
+			entries[most_recent].newer = entry_idx;
+		else
+			least_recent = entry_idx;
+		most_recent = entry_idx;
+	}
+
+	void unlink(int entry_idx)
+	{
+		Entry const & entry = entries[entry_idx];
+		if (entry.newer != -1)
+			entries[entry.newer].older = entry.older;
+		else
+			most_recent = entry.older;
+		if (entry.older != -1)
+			entries[entry.older].newer = entry.newer;
+		else
+			least_recent = entry.newer;
+	}
+
+	void evict()
+	{
+		assert(least_recent != -1);
+		++stats.evictions;
+		int const entry_idx = least_recent;
+		unlink(entry_idx);
+		live_size -= entries[entry_idx].size;
+		erase_pos(find_pos(entries[entry_idx].key));
+		free_entries[num_free_entries++] = entry_idx;
+	}
+
+	// Empties pos in index, moving back the following keys of its probe sequence so that they are still found.
+	void erase_pos(int pos)
+	{
+		for (int next = (pos + 1) & index_mask; index[next] != -1; next = (next + 1) & index_mask)
+		{
+			// the key at next can fill pos if its home position is not between pos (excluded) and next
+			int const home = get_home_pos(entries[index[next]].key);
+			if (((next - home) & index_mask) >= ((next - pos) & index_mask))
+			{
+				index[pos] = index[next];
+				pos = next;
+			}
+		}
+		index[pos] = -1;
+	}
+
+	// Moves records of the entries to the start of arena, keeping their order.
+	void compact()
+	{
+		int num_entries = 0;
+		for (int entry_idx = most_recent; entry_idx != -1; entry_idx = entries[entry_idx].older)
+			compacted_entries[num_entries++] = entry_idx;
+		std::sort(&compacted_entries[0], &compacted_entries[0] + num_entries, [this](int lhs, int rhs)
+		{
+			return entries[lhs].offset < entries[rhs].offset;
+		});
+		arena_end = 0;
+		for (int i = 0; i < num_entries; ++i)
+		{
+			Entry & entry = entries[compacted_entries[i]];
+			std::memmove(&arena[arena_end], &arena[entry.offset], entry.size);
+			entry.offset = arena_end;
+			arena_end += entry.size;
+		}
+		assert(arena_end == live_size);
+	}
+
+	size_t const arena_size;
+	int const max_num_entries;
+	int const index_mask;
+	std::unique_ptr<char[]> arena;
+	size_t arena_end; // records are appended here
+	size_t live_size; // total size of records of entries, the rest of [0; arena_end) is records of evicted entries
+	std::unique_ptr<Entry[]> entries;
+	std::unique_ptr<int[]> free_entries;
+	int num_free_entries;
+	std::unique_ptr<int[]> index; // indices in entries, -1 for empty positions
+	std::unique_ptr<int[]> compacted_entries; // for compact()
+	int most_recent;
+	int least_recent;
+	Stats stats;
+};
+
+std::ostream & operator<<(std::ostream & out, RowCompletionsCache::Stats const & stats)
+{
+	return out << "lookups: " << stats.lookups
+		<< " hits: " << stats.hits
+		<< " inserts: " << stats.inserts
+		<< " evictions: " << stats.evictions;
+}
+
+/*
+ * A team of threads running the same job together: run() calls job(thread_idx) on each of num_threads threads (the
+ * calling thread being thread 0) and returns when all of them are done.
+ */
+class ThreadTeam
+{
+public:
+	using Job = std::function<void(int thread_idx)>;
+
+	explicit ThreadTeam(int num_threads):
+		num_threads(num_threads),
+		mutex(),
+		start_cond(),
+		done_cond(),
+		job(nullptr),
+		job_generation(0),
+		num_running(0),
+		stopping(false),
+		threads()
+	{
+		assert(num_threads > 0);
+		for (int thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+			threads.emplace_back(&ThreadTeam::work, this, thread_idx);
+	}
+
+	~ThreadTeam()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		start_cond.notify_all();
+		for (std::thread & thread : threads)
+			thread.join();
+	}
+
+	int get_num_threads() const
+	{
+		return num_threads;
+	}
+
+	void run(Job const & job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->job = &job;
+			++job_generation;
+			num_running = num_threads - 1;
+		}
+		start_cond.notify_all();
+
+		job(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		done_cond.wait(lock, [this]() { return num_running == 0; });
+		this->job = nullptr;
+	}
+
+private:
+	void work(int thread_idx)
+	{
+		uint64_t done_generation = 0;
+		while (true)
+		{
+			Job const * current_job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start_cond.wait(lock, [&]() { return stopping || job_generation != done_generation; });
+				if (stopping)
+					return;
+				done_generation = job_generation;
+				current_job = job;
+			}
+
+			(*current_job)(thread_idx);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--num_running == 0)
+				done_cond.notify_one();
+		}
+	}
+
+	int const num_threads;
+	std::mutex mutex;
+	std::condition_variable start_cond;
+	std::condition_variable done_cond;
+	Job const * job;
+	uint64_t job_generation;
+	int num_running;
+	bool stopping;
+	std::vector<std::thread> threads;
+};
+
+// Values in binary files (checkpoints and memo dumps), in the byte order of the machine.
+template <typename T>
+void write_value(std::ostream & out, T const & value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+	out.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::istream & in, T & value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "only plain values can be read");
+	return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(T));
+}
+
+// Writes atomic entries of a table, relaxed loads are fine as it is dumped while it is not used.
+void write_entries(std::ostream & out, std::atomic<uint64_t> const * entries, uint64_t num_entries)
+{
+	write_value(out, num_entries);
+	for (uint64_t idx = 0; idx < num_entries; ++idx)
+		write_value(out, entries[idx].load(std::memory_order_relaxed));
+}
+
+// Reads entries written by write_entries() into a table of the same size, which is left unchanged if they could not be
+// read.
+bool read_entries(std::istream & in, std::atomic<uint64_t> * entries, uint64_t num_entries)
+{
+	uint64_t num_read_entries;
+	if (!read_value(in, num_read_entries) || num_read_entries != num_entries)
+		return false;
+	std::vector<uint64_t> read(num_entries);
+	if (!in.read(reinterpret_cast<char *>(read.data()), num_entries * sizeof(uint64_t)))
+		return false;
+	for (uint64_t idx = 0; idx < num_entries; ++idx)
+		entries[idx].store(read[idx], std::memory_order_relaxed);
+	return true;
+}
+
+/*
+ * Fixed-size table of keys (Board::get_key()) of boards that were processed. Entries are single 64-bit words packing
+ * the key (its low 8 bits replaced by rec_level, they are implied by the bucket index) so they can be read and written
+ * with relaxed atomics, which lets threads share the table without locking. A bucket has two entries; when both are
+ * taken, the one with the higher rec_level (so the smaller subtree) is evicted.
+ *
+ * A key that matches is taken to be the same board, a false match (which needs two of the processed boards to agree
+ * on all 64 bits) would lose the solutions below the board.
+ *
+ * Boards are only looked up and inserted at rec_level <= max_rec_level, which is adapted: every adapt_window lookups
+ * at max_rec_level, it goes one deeper if the hit rate there was high and one shallower if it was very low.
+ */
+class TranspositionTable
+{
+public:
+	struct Stats
+	{
+		uint64_t lookups = 0;
+		uint64_t hits = 0;
+		uint64_t inserts = 0;
+		uint64_t evictions = 0;
+		int max_rec_level = 0;
+	};
+
+	static constexpr int default_size_log2 = 20;
+	static constexpr int default_max_rec_level = 5;
+
+	// initial_max_rec_level: max_rec_level before it is adapted
+	explicit TranspositionTable(int size_log2 = default_size_log2, int initial_max_rec_level = default_max_rec_level):
+		index_mask(((uint64_t)1 << size_log2) - 1),
+		entries(new std::atomic<uint64_t>[2 * (index_mask + 1)]),
+		max_rec_level(initial_max_rec_level),
+		num_lookups(0),
+		num_hits(0),
+		num_inserts(0),
+		num_evictions(0),
+		window_lookups(0),
+		window_hits(0)
+	{
+		assert(size_log2 >= 8);
+		assert(initial_max_rec_level >= 0 && initial_max_rec_level < 0xff);
+		for (uint64_t i = 0; i < 2 * (index_mask + 1); ++i)
+			entries[i].store(empty_entry, std::memory_order_relaxed);
+	}
+
+	bool is_used_at(int rec_level) const
+	{
+		return rec_level <= max_rec_level.load(std::memory_order_relaxed);
+	}
+
+	bool contains(uint64_t key, int rec_level)
+	{
+		uint64_t const entry = make_entry(key, rec_level);
+		std::atomic<uint64_t> const * const bucket = get_bucket(key);
+		bool const is_hit = bucket[0].load(std::memory_order_relaxed) == entry
+			|| bucket[1].load(std::memory_order_relaxed) == entry;
+
+		num_lookups.fetch_add(1, std::memory_order_relaxed);
+		if (is_hit)
+			num_hits.fetch_add(1, std::memory_order_relaxed);
+		if (rec_level == max_rec_level.load(std::memory_order_relaxed))
+			adapt(is_hit);
+		return is_hit;
+	}
+
+	void insert(uint64_t key, int rec_level)
+	{
+		uint64_t const entry = make_entry(key, rec_level);
+		std::atomic<uint64_t> * const bucket = get_bucket(key);
+		uint64_t const old_entries[2] = {
+			bucket[0].load(std::memory_order_relaxed), bucket[1].load(std::memory_order_relaxed)};
+		if (old_entries[0] == entry || old_entries[1] == entry)
+			return;
+
+		num_inserts.fetch_add(1, std::memory_order_relaxed);
+		int victim_idx;
+		if (old_entries[0] == empty_entry)
+			victim_idx = 0;
+		else if (old_entries[1] == empty_entry)
+			victim_idx = 1;
+		else
+		{
+			victim_idx = (old_entries[0] & 0xff) >= (old_entries[1] & 0xff) ? 0 : 1;
+			num_evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+		bucket[victim_idx].store(entry, std::memory_order_relaxed);
+	}
+
+	Stats get_stats() const
+	{
+		Stats stats;
+		stats.lookups = num_lookups.load(std::memory_order_relaxed);
+		stats.hits = num_hits.load(std::memory_order_relaxed);
+		stats.inserts = num_inserts.load(std::memory_order_relaxed);
+		stats.evictions = num_evictions.load(std::memory_order_relaxed);
+		stats.max_rec_level = max_rec_level.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	// Writes entries and max_rec_level (not statistics), for load() in a later run.
+	void save(std::ostream & out) const
+	{
+		write_value(out, max_rec_level.load(std::memory_order_relaxed));
+		write_entries(out, entries.get(), 2 * (index_mask + 1));
+	}
+
+	// Reads what save() wrote, into a table of the same size.
+	// return value: false if it could not be read
+	bool load(std::istream & in)
+	{
+		int level;
+		if (!read_value(in, level) || level < 0 || level >= 0xff
+				|| !read_entries(in, entries.get(), 2 * (index_mask + 1)))
+			return false;
+		max_rec_level.store(level, std::memory_order_relaxed);
+		return true;
+	}
+
+private:
+	static constexpr uint64_t empty_entry = 0;
+	static constexpr int min_max_rec_level = 2;
+	static constexpr int adapt_window = 1 << 10;
+
+	uint64_t make_entry(uint64_t key, int rec_level) const
+	{
+		assert(rec_level >= 0 && rec_level < 0xff);
+		// rec_level + 1 so that no entry is empty_entry
+		return (key & ~(uint64_t)0xff) | (uint64_t)(rec_level + 1);
+	}
+
+	std::atomic<uint64_t> * get_bucket(uint64_t key) const
+	{
+		// index is taken from bits above the 8 replaced in entries, so that they still tell keys apart
+		return &entries[2 * ((key >> 8 ^ key) & index_mask)];
+	}
+
+	void adapt(bool is_hit)
+	{
+		if (is_hit)
+			window_hits.fetch_add(1, std::memory_order_relaxed);
+		if (window_lookups.fetch_add(1, std::memory_order_relaxed) + 1 != adapt_window)
+			return;
+
+		uint64_t const hits = window_hits.exchange(0, std::memory_order_relaxed);
+		window_lookups.store(0, std::memory_order_relaxed);
+		int const level = max_rec_level.load(std::memory_order_relaxed);
+		if (hits * 64 >= adapt_window)
+			max_rec_level.store(std::min(level + 1, 0xff - 1), std::memory_order_relaxed);
+		else if (hits * 1024 < adapt_window && level > min_max_rec_level)
+			max_rec_level.store(level - 1, std::memory_order_relaxed);
+
+		DBG(std::cout << "TranspositionTable: " << hits << " hits in " << adapt_window << " lookups at rec_level: "
+			<< level << ", max_rec_level is now: " << max_rec_level.load(std::memory_order_relaxed) << std::endl);
+	}
+
+	uint64_t const index_mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> entries;
+	std::atomic<int> max_rec_level;
+	std::atomic<uint64_t> num_lookups;
+	std::atomic<uint64_t> num_hits;
+	std::atomic<uint64_t> num_inserts;
+	std::atomic<uint64_t> num_evictions;
+	std::atomic<uint64_t> window_lookups; // lookups at max_rec_level since last adapt
+	std::atomic<uint64_t> window_hits;
+};
+
+std::ostream & operator<<(std::ostream & out, TranspositionTable::Stats const & stats)
+{
+	return out << "lookups: " << stats.lookups
+		<< " hits: " << stats.hits
+		<< " inserts: " << stats.inserts
+		<< " evictions: " << stats.evictions
+		<< " max_rec_level: " << stats.max_rec_level;
+}
+
+/*
+ * Fixed-size table of nogoods: keys (Board::compute_row_neighborhood_key()) of neighborhoods in which processing a row
+ * found no completions. Such row fails again wherever the same neighborhood comes back, under any other branch, as
+ * long as its failure did not depend on numbers elsewhere in the grid (those failures are not recorded).
+ *
+ * Entries are single 64-bit words packing the key (its low 8 bits replaced by a hit count) so they can be read and
+ * written with relaxed atomics, which lets threads share the table without locking. A bucket has four entries; when
+ * all are taken, the one with the fewest hits is evicted and counts of the other ones are halved, so that nogoods which
+ * stopped being useful get evicted eventually too.
+ */
+class NogoodStore
+{
+public:
+	struct Stats
+	{
+		uint64_t lookups = 0;
+		uint64_t hits = 0;
+		uint64_t inserts = 0;
+		uint64_t evictions = 0;
+	};
+
+	static constexpr int default_size_log2 = 16;
+
+	explicit NogoodStore(int size_log2 = default_size_log2):
+		index_mask(((uint64_t)1 << size_log2) - 1),
+		entries(new std::atomic<uint64_t>[bucket_size * (index_mask + 1)]),
+		num_lookups(0),
+		num_hits(0),
+		num_inserts(0),
+		num_evictions(0)
+	{
+		assert(size_log2 >= 8);
+		for (uint64_t i = 0; i < bucket_size * (index_mask + 1); ++i)
+			entries[i].store(empty_entry, std::memory_order_relaxed);
+	}
+
+	bool contains(uint64_t key)
+	{
+		num_lookups.fetch_add(1, std::memory_order_relaxed);
+		std::atomic<uint64_t> * const bucket = get_bucket(key);
+		for (int i = 0; i < bucket_size; ++i)
+		{
+			uint64_t const entry = bucket[i].load(std::memory_order_relaxed);
+			if (entry != empty_entry && is_entry_of(entry, key))
+			{
+				if ((entry & 0xff) != 0xff)
+					bucket[i].store(entry + 1, std::memory_order_relaxed);
+				num_hits.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void insert(uint64_t key)
+	{
+		std::atomic<uint64_t> * const bucket = get_bucket(key);
+		uint64_t old_entries[bucket_size];
+		int victim_idx = -1;
+		for (int i = 0; i < bucket_size; ++i)
+		{
+			old_entries[i] = bucket[i].load(std::memory_order_relaxed);
+			if (old_entries[i] != empty_entry && is_entry_of(old_entries[i], key))
+				return;
+			if (old_entries[i] == empty_entry && victim_idx == -1)
+				victim_idx = i;
+		}
+
+		num_inserts.fetch_add(1, std::memory_order_relaxed);
+		if (victim_idx == -1)
+		{
+			victim_idx = 0;
+			for (int i = 1; i < bucket_size; ++i)
+			{
+				if ((old_entries[i] & 0xff) < (old_entries[victim_idx] & 0xff))
+					victim_idx = i;
+			}
+			for (int i = 0; i < bucket_size; ++i)
+			{
+				uint64_t const hits = old_entries[i] & 0xff;
+				if (i != victim_idx && hits > 1)
+					bucket[i].store(old_entries[i] - hits + hits / 2, std::memory_order_relaxed);
+			}
+			num_evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+		// hit count starts at 1 so that no entry is empty_entry
+		bucket[victim_idx].store((key & ~(uint64_t)0xff) | 1, std::memory_order_relaxed);
+	}
+
+	Stats get_stats() const
+	{
+		Stats stats;
+		stats.lookups = num_lookups.load(std::memory_order_relaxed);
+		stats.hits = num_hits.load(std::memory_order_relaxed);
+		stats.inserts = num_inserts.load(std::memory_order_relaxed);
+		stats.evictions = num_evictions.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	// Writes entries (not statistics), for load() in a later run.
+	void save(std::ostream & out) const
+	{
+		write_entries(out, entries.get(), bucket_size * (index_mask + 1));
+	}
+
+	// Reads what save() wrote, into a table of the same size.
+	// return value: false if it could not be read
+	bool load(std::istream & in)
+	{
+		return read_entries(in, entries.get(), bucket_size * (index_mask + 1));
+	}
+
+private:
+	static constexpr uint64_t empty_entry = 0;
+	static constexpr int bucket_size = 4;
+
+	static bool is_entry_of(uint64_t entry, uint64_t key)
+	{
+		return (entry & ~(uint64_t)0xff) == (key & ~(uint64_t)0xff);
+	}
+
+	std::atomic<uint64_t> * get_bucket(uint64_t key) const
+	{
+		// index is taken from bits above the 8 replaced in entries, so that they still tell keys apart
+		return &entries[bucket_size * ((key >> 8 ^ key) & index_mask)];
+	}
+
+	uint64_t const index_mask;
+	std::unique_ptr<std::atomic<uint64_t>[]> entries;
+	std::atomic<uint64_t> num_lookups;
+	std::atomic<uint64_t> num_hits;
+	std::atomic<uint64_t> num_inserts;
+	std::atomic<uint64_t> num_evictions;
+};
+
+std::ostream & operator<<(std::ostream & out, NogoodStore::Stats const & stats)
+{
+	return out << "lookups: " << stats.lookups
+		<< " hits: " << stats.hits
+		<< " inserts: " << stats.inserts
+		<< " evictions: " << stats.evictions;
+}
+
+// Order in which NumberCrossSolver checks degrees of rows, the first row with the lowest degree is processed.
+enum class RowOrder
+{
+	unassigned_regions, // rows with fewer regions without value in [row-1; row+1] first
+	row_index, // rows from top to bottom
+	processed_neighbors, // rows with more processed rows in [row-2; row+2] first
+};
+
+std::ostream & operator<<(std::ostream & out, RowOrder row_order)
+{
+	switch (row_order)
+	{
+	case RowOrder::unassigned_regions: return out << "unassigned_regions";
+	case RowOrder::row_index: return out << "row_index";
+	case RowOrder::processed_neighbors: return out << "processed_neighbors";
+	}
+	return out;
+}
+
+// Heuristics of NumberCrossSolver, they change how fast it finishes but not the solutions it finds.
+struct SearchConfig
+{
+	RowOrder row_order = RowOrder::unassigned_regions;
+	// rows whose degree is checked at each level, 0 for all of them (with fewer rows checked, the best one may be missed),
+	// not used with probe threads
+	int max_probed_rows = 0;
+	// initial max_rec_level of processed boards
+	int memo_rec_level = TranspositionTable::default_max_rec_level;
+	// if not 0, rows in the same place of row_order are shuffled by a generator seeded with it
+	uint64_t seed = 0;
+	// if not 0, the search is restarted (keeping processed boards and nogoods) after that many calls of rec_solve(),
+	// the limit doubling with each restart
+	uint64_t restart_rec_solves = 0;
+	// if true, costs of checking degrees of rows and of their subtrees are learned, and checking a row's degree is
+	// skipped when it is expected to cost too much compared to the subtree of the best row found so far (not with probe
+	// threads)
+	bool use_impacts = true;
+};
+
+std::ostream & operator<<(std::ostream & out, SearchConfig const & config)
+{
+	return out << "row_order: " << config.row_order
+		<< " max_probed_rows: " << config.max_probed_rows
+		<< " memo_rec_level: " << config.memo_rec_level
+		<< " seed: " << config.seed
+		<< " restart_rec_solves: " << config.restart_rec_solves
+		<< " use_impacts: " << config.use_impacts;
+}
+
+/*
+ * Position of NumberCrossSolver's search: the row processed at each rec_level from 0 on and the index of its branch
+ * (completion of the row) that is being searched. Branches before it are searched completely, so the search can be
+ * resumed from the position by skipping them. Branches are indexed in the order RowProcessor enumerates completions,
+ * which depends only on the board, so the index is the same when they are enumerated again.
+ */
+struct SearchPosition
+{
+	struct Step
+	{
+		int row;
+		uint32_t branch_idx;
+	};
+
+	int path_length = 0;
+	Step path[max_num_rows]; // [rec_level]
+};
+
+class NumberCrossSolver
+{
+public:
+	// Callback is called when grid is solved, with the solved board.
+	using Callback = std::function<void(Board const &)>;
+
+	// SplitCallback is called instead of recursing into a branch, with the board of that branch (all its rows that are
+	// processed have final cell values) and its rec_level. The branch is then expected to be solved separately.
+	using SplitCallback = std::function<void(Board const &, int rec_level)>;
+
+	using ProcessedBoards = TranspositionTable;
+
+	// CheckpointCallback is called with the position of the search, to save it.
+	using CheckpointCallback = std::function<void(SearchPosition const &)>;
+
+	// Learned costs of a row at a rec_level, in RowProcessor steps. They are averages over nodes at the same rec_level,
+	// which are siblings and cousins in the search tree, so they have similar boards. -1 if not known yet.
+	struct RowImpact
+	{
+		double probe_steps = -1; // of checking degree of the row
+		double branch_steps = -1; // of the subtree of each branch when the row was processed
+	};
+
+	// What solvers learn about rows of a board as they search it. It holds in any branch of the board, so solvers run one
+	// after the other (not concurrently) can share it, instead of learning it again.
+	struct RowKnowledge
+	{
+		RowImpact row_impacts[max_num_rows + 1][max_num_rows]; // [rec_level][row], see SearchConfig::use_impacts
+		RowCompletionsCache completions_cache;
+	};
+
+	// With probe_threads > 1, degrees of rows are checked concurrently.
+	NumberCrossSolver(Board & board, Callback const & callback, int probe_threads = 1,
+			SearchConfig const & config = SearchConfig()):
+		board(board),
+		callback(callback),
+		config(config),
+		rec_level(0),
+		own_processed_boards(new ProcessedBoards(ProcessedBoards::default_size_log2, config.memo_rec_level)),
+		processed_boards(*own_processed_boards),
+		own_nogoods(new NogoodStore()),
+		nogoods(*own_nogoods),
+		split_rec_level(0),
+		split_callback(),
+		probe_team(probe_threads > 1 ? new ThreadTeam(probe_threads) : nullptr),
+		best_completions(),
+		candidate_completions(),
+		probe_completions(),
+		own_row_knowledge(new RowKnowledge()),
+		row_knowledge(*own_row_knowledge),
+		rows_to_solve(((uint32_t)1 << board.num_rows) - 1),
+		solutions_output(nullptr),
+		component_solutions(),
+		rng(config.seed),
+		cancel_flag(nullptr),
+		num_rec_solves(0),
+		max_rec_solves(0),
+		is_stopped(false),
+		num_steps(0),
+		checkpoint_callback(),
+		checkpoint_interval(),
+		next_checkpoint_time(),
+		position(),
+		resume_position(),
+		resume_length(0)
+	{
+	}
+
+	// Solves a branch starting at rec_level. Branches down to split_rec_level are passed to split_callback instead of
+	// being solved here. processed_boards and nogoods may be shared with other solvers, row_knowledge with solvers run
+	// on the same thread.
+	NumberCrossSolver(Board & board, int rec_level, Callback const & callback, ProcessedBoards & processed_boards,
+			NogoodStore & nogoods, RowKnowledge & row_knowledge, int split_rec_level,
+			SplitCallback const & split_callback):
+		board(board),
+		callback(callback),
+		config(),
+		rec_level(rec_level),
+		own_processed_boards(),
+		processed_boards(processed_boards),
+		own_nogoods(),
+		nogoods(nogoods),
+		split_rec_level(split_rec_level),
+		split_callback(split_callback),
+		probe_team(),
+		best_completions(),
+		candidate_completions(),
+		probe_completions(),
+		own_row_knowledge(),
+		row_knowledge(row_knowledge),
+		rows_to_solve(((uint32_t)1 << board.num_rows) - 1),
+		solutions_output(nullptr),
+		component_solutions(),
+		rng(config.seed),
+		cancel_flag(nullptr),
+		num_rec_solves(0),
+		max_rec_solves(0),
+		is_stopped(false),
+		num_steps(0),
+		checkpoint_callback(),
+		checkpoint_interval(),
+		next_checkpoint_time(),
+		position(),
+		resume_position(),
+		resume_length(0)
+	{
+	}
+
+	// return value: false if the search was cancelled
+	bool run()
+	{
+		max_rec_solves = config.restart_rec_solves;
+		next_checkpoint_time = std::chrono::steady_clock::now() + checkpoint_interval;
+		resume_length = resume_position.path_length;
+		while (true)
+		{
+			num_rec_solves = 0;
+			is_stopped = false;
+			rec_solve();
+			if (!is_stopped || is_cancelled())
+				break;
+			DBG(std::cout << __func__ << " restarting after " << num_rec_solves << " calls of rec_solve" << std::endl);
+			max_rec_solves *= 2;
+		}
+		return !is_stopped;
+	}
+
+	// The search stops soon after *cancel_flag becomes true.
+	void set_cancel_flag(std::atomic<bool> const * cancel_flag)
+	{
+		this->cancel_flag = cancel_flag;
+	}
+
+	// checkpoint_callback is called every interval and when the search is cancelled. Solutions reported before it are
+	// the ones found in branches before the position, and possibly a few in the branches of the position.
+	void set_checkpoint_callback(CheckpointCallback const & checkpoint_callback,
+			std::chrono::steady_clock::duration interval)
+	{
+		this->checkpoint_callback = checkpoint_callback;
+		checkpoint_interval = interval;
+	}
+
+	// run() fast-forwards to the position, skipping branches before it without searching them. The position must be
+	// one saved by a solver of the same board.
+	void set_resume_position(SearchPosition const & position)
+	{
+		resume_position = position;
+	}
+
+	// Processed boards and nogoods, to load them in a later run. Boards are processed completely only when all their
+	// branches are, so together with a position saved after them, they can be loaded to resume the search too.
+	void save_memo(std::ostream & out) const
+	{
+		processed_boards.save(out);
+		nogoods.save(out);
+	}
+
+	// return value: false if they could not be read
+	bool load_memo(std::istream & in)
+	{
+		return processed_boards.load(in) && nogoods.load(in);
+	}
+
+	TranspositionTable::Stats get_processed_boards_stats() const
+	{
+		return processed_boards.get_stats();
+	}
+
+	NogoodStore::Stats get_nogoods_stats() const
+	{
+		return nogoods.get_stats();
+	}
+
+	RowCompletionsCache::Stats const & get_completions_cache_stats() const
+	{
+		return row_knowledge.completions_cache.get_stats();
+	}
+
+private:
+	// pairs of (order value, row), see rec_solve()
+	struct RowsToCheck
+	{
+		int num_rows = 0;
+		std::pair<int, int> rows[max_num_rows];
+
+		std::pair<int, int> * begin() { return &rows[0]; }
+		std::pair<int, int> * end() { return &rows[num_rows]; }
+		std::pair<int, int> const * begin() const { return &rows[0]; }
+		std::pair<int, int> const * end() const { return &rows[num_rows]; }
+	};
+
+	void rec_solve()
+	{
+		++num_rec_solves;
+		if (checkpoint_callback && std::chrono::steady_clock::now() >= next_checkpoint_time)
+			save_checkpoint();
+		if (should_stop())
+			return;
+
+		uint64_t const board_key = board.get_key();
+		assert(board_key == board.compute_key());
+		if (processed_boards.is_used_at(rec_level))
+		{
+			if (processed_boards.contains(board_key, rec_level))
+			{
+				DBG(std::cout << __func__
+					<< " rec_level: " << rec_level
+					<< " board already processed, skipping" << std::endl);
+				return;
+			}
+		}
+
+		if (!solve_components())
+			solve_best_row();
+
+		assert(board.get_key() == board_key);
+		// a board whose search was stopped is not processed yet
+		if (processed_boards.is_used_at(rec_level) && !is_stopped)
+			processed_boards.insert(board_key, rec_level);
+	}
+
+	bool is_cancelled() const
+	{
+		return cancel_flag && cancel_flag->load(std::memory_order_relaxed);
+	}
+
+	// return value: true if the search should be stopped because it was cancelled or is to be restarted
+	bool should_stop()
+	{
+		if (!is_stopped)
+		{
+			is_stopped = is_cancelled() || (max_rec_solves != 0 && num_rec_solves > max_rec_solves);
+			// the search can be resumed where it was cancelled
+			if (is_stopped && is_cancelled() && checkpoint_callback)
+				save_checkpoint();
+		}
+		return is_stopped;
+	}
+
+	void save_checkpoint()
+	{
+		DBG(std::cout << __func__ << " path_length: " << position.path_length << std::endl);
+		checkpoint_callback(position);
+		next_checkpoint_time = std::chrono::steady_clock::now() + checkpoint_interval;
+	}
+
+	// Processes the best row of rows_to_solve and recurses, or reports the solution if all of them are processed.
+	void solve_best_row()
+	{
+		// Pick the most promising row that has not been processed yet. If no such row then print answer.
+		// Row is better if it has lower branching degree, i.e. lower number of direct calls to rec_solve().
+
+		// Prepare a vector of rows to check, in a heuristic order from the lowest branching degree.
+		RowsToCheck rows_to_check;
+		for (int row_to_check = 0; row_to_check < board.num_rows; ++row_to_check)
+		{
+			if (rows_to_solve >> row_to_check & 1 && !board.get_row_is_processed(row_to_check))
+			{
+				int const order_val = get_row_order_value(row_to_check);
+				rows_to_check.rows[rows_to_check.num_rows++] = {order_val, row_to_check};
+			}
+		}
+		std::sort(rows_to_check.begin(), rows_to_check.end());
+		if (config.seed != 0)
+		{
+			// break ties of order values randomly
+			for (auto first = rows_to_check.begin(); first != rows_to_check.end(); )
+			{
+				auto const last = std::find_if(first, rows_to_check.end(),
+						[first](std::pair<int, int> const & p) { return p.first != first->first; });
+				std::shuffle(first, last, rng);
+				first = last;
+			}
+		}
+
+		// find best row, or take the one of the position being resumed (its degree is not known then)
+		int best_row = -1;
+		uint32_t best_row_degree = std::numeric_limits<uint32_t>::max();
+		// positions are tracked outside of solve_components(), whose solutions are only kept in memory, and a resumed
+		// position does not go into it
+		bool const is_tracked = !solutions_output;
+		bool const is_resumed = rec_level < resume_length;
+		assert(is_tracked || !is_resumed);
+		if (is_resumed)
+			best_row = resume_position.path[rec_level].row;
+		else if (probe_team)
+			find_best_row_parallel(rows_to_check, best_row, best_row_degree);
+		else
+			find_best_row(rows_to_check, best_row, best_row_degree);
+
+		if (best_row_degree == std::numeric_limits<uint32_t>::max() && !is_resumed)
+		{
+			// all rows were processed
+			report_solution();
+		}
+		else if (best_row_degree > 0)
+		{
+			DBG(std::cout << __func__
+				<< " rec_level: " << rec_level
+				<< " start processing best_row: " << best_row
+				<< " with degree: " << best_row_degree << std::endl);
+
+			// process best row, calling us recursively
+			assert(!board.get_row_is_processed(best_row));
+			board.set_row_is_processed(best_row, true);
+			uint64_t const orig_num_steps = num_steps;
+			SearchPosition::Step * const step = is_tracked ? &position.path[rec_level] : nullptr;
+			// branches are passed to split_callback, except in a component, whose solutions are combined by this solver
+			bool const is_split = rec_level < split_rec_level && !solutions_output;
+			if (step)
+			{
+				*step = {best_row, 0};
+				position.path_length = rec_level + 1;
+			}
+			auto const process_branch = [this, step, is_split]()
+			{
+				if (rec_level < resume_length && step->branch_idx < resume_position.path[rec_level].branch_idx)
+				{
+					// searched before the position was saved
+					++step->branch_idx;
+					return true;
+				}
+				++rec_level;
+				if (is_split)
+					split_callback(board, rec_level);
+				else
+					rec_solve();
+				--rec_level;
+				// the branch of the position, and all levels below it, are resumed
+				resume_length = 0;
+				if (step)
+					++step->branch_idx;
+				return !should_stop();
+			};
+			// The degree of a resumed row is not checked, so its completions are not recorded. Branches of the position
+			// are skipped by index when it is resumed, so on levels of a position which may be saved, completions from
+			// completions_cache (captured on another board, maybe in another order) are not replayed either.
+			RowCompletions const * const completions = is_resumed ? nullptr : best_completions[rec_level].get();
+			if (completions && completions->get_current_row() == best_row && completions->is_complete()
+					&& !(step && checkpoint_callback && completions->get_is_loaded()))
+			{
+				// replay completions recorded (or found in completions_cache) when checking degree of best_row, the ones
+				// from the cache may have numbers which are already in the grid
+				int num_replayed = 0;
+				for (int idx = 0; idx < completions->size(); ++idx)
+				{
+					if (!completions->apply(board, idx))
+						continue;
+					++num_replayed;
+					bool const visit_more = process_branch();
+					completions->undo(board, idx);
+					if (!visit_more)
+						break;
+				}
+				assert(num_replayed == (int)best_row_degree || is_stopped);
+				(void)num_replayed;
+			}
+			else
+			{
+				RowProcessor work(board, best_row, process_branch);
+				work.run();
+				num_steps += work.get_num_steps();
+			}
+			board.set_row_is_processed(best_row, false);
+			if (step)
+				position.path_length = rec_level;
+			// branches passed to split_callback cost nothing here
+			if (!is_stopped && !is_resumed && !is_split)
+				update_average(row_knowledge.row_impacts[rec_level][best_row].branch_steps,
+						(double)(num_steps - orig_num_steps) / best_row_degree);
+		}
+	}
+
+	// Checking degree of a row is skipped when it is expected to cost more than 1/max_probe_cost_ratio of the subtree of
+	// the best row found so far.
+	static constexpr int max_probe_cost_ratio = 4;
+
+	// Exponential moving average, recent nodes weigh more as the board changes slowly.
+	static void update_average(double & average, double value)
+	{
+		if (average < 0)
+			average = value;
+		else
+			average += (value - average) / 8;
+	}
+
+	// Rows with lower values are checked first, see SearchConfig::row_order.
+	int get_row_order_value(int row_to_check) const
+	{
+		switch (config.row_order)
+		{
+		case RowOrder::unassigned_regions:
+		{
+			// Compute number of different regions that don't have their value set yet. Check each row in
+			// [row_to_check-1; row_to_check+1].
+			std::bitset<max_num_regions> regions_without_value;
+			for (int row = row_to_check - 1; row <= row_to_check + 1; ++row)
+			{
+				if (row >= 0 && row < board.num_rows)
+				{
+					for (int col = 0; col < board.num_cols; ++col)
+					{
+						int const region_idx = board.get_cell_region({row, col});
+						if (board.get_region_value(region_idx) == -1)
+							regions_without_value.set(region_idx);
+					}
+				}
+			}
+			return regions_without_value.count();
+		}
+		case RowOrder::row_index:
+			return 0;
+		case RowOrder::processed_neighbors:
+		{
+			int num_processed = 0;
+			for (int row = std::max(row_to_check - 2, 0); row <= std::min(row_to_check + 2, board.num_rows - 1); ++row)
+				num_processed += board.get_row_is_processed(row);
+			return -num_processed;
+		}
+		}
+		return 0;
+	}
+
+	void report_solution()
+	{
+		if (solutions_output)
+			solutions_output->push_back(board);
+		else
+			callback(board);
+	}
+
+	// Rows of rows_to_solve that are not processed yet, split into components that can be solved independently.
+	struct Components
+	{
+		int num_components = 0;
+		uint32_t rows[max_num_rows]; // i'th bit is for row i
+	};
+
+	/*
+	 * Processing a row fixes its cells and assigns regions and places tiles in the adjacent rows. Two rows that are not
+	 * processed yet depend on each other when:
+	 * - they are adjacent,
+	 * - there is a tile with value left between them, which can displace to both,
+	 * - regions without value in the rows adjacent to them (or including them) are the same or neighbors (which must
+	 *   have different values).
+	 * Otherwise they change different cells, tiles (or different cells_for_displacement of the same tile), regions and
+	 * row flags, and only uniqueness of their numbers needs to be checked when combining their solutions.
+	 */
+	void find_components(Components & components) const
+	{
+		// regions without value in rows [row-1; row+1] of each row, and the same together with their neighbors
+		uint32_t regions[max_num_rows];
+		uint32_t near_regions[max_num_rows];
+		int component_of_row[max_num_rows];
+		for (int row = 0; row < board.num_rows; ++row)
+		{
+			component_of_row[row] = -1;
+			if (!(rows_to_solve >> row & 1) || board.get_row_is_processed(row))
+				continue;
+			regions[row] = 0;
+			for (int adjacent_row = std::max(row - 1, 0); adjacent_row <= std::min(row + 1, board.num_rows - 1);
+					++adjacent_row)
+			{
+				for (int col = 0; col < board.num_cols; ++col)
+				{
+					int const region_idx = board.get_cell_region({adjacent_row, col});
+					if (board.get_region_value(region_idx) == -1)
+						regions[row] |= (uint32_t)1 << region_idx;
+				}
+			}
+			near_regions[row] = regions[row];
+			for (uint32_t rest = regions[row]; rest != 0; rest &= rest - 1)
+			{
+				for (int8_t const neighbor_idx : board.get_region_neighbors(__builtin_ctz(rest)))
+					near_regions[row] |= (uint32_t)1 << neighbor_idx;
+			}
+		}
+
+		// each row joins the component of the first earlier row it depends on, merging the other ones into it
+		components.num_components = 0;
+		for (int row = 0; row < board.num_rows; ++row)
+		{
+			if (!(rows_to_solve >> row & 1) || board.get_row_is_processed(row))
+				continue;
+			int component_idx = -1;
+			for (int other_row = 0; other_row < row; ++other_row)
+			{
+				int const other_component_idx = component_of_row[other_row];
+				if (other_component_idx == -1 || other_component_idx == component_idx
+						|| !are_rows_dependent(other_row, row, regions, near_regions))
+					continue;
+				if (component_idx == -1)
+				{
+					component_idx = other_component_idx;
+					continue;
+				}
+				// merge other_component_idx into component_idx
+				components.rows[component_idx] |= components.rows[other_component_idx];
+				for (int merged_row = 0; merged_row < row; ++merged_row)
+				{
+					if (component_of_row[merged_row] == other_component_idx)
+						component_of_row[merged_row] = component_idx;
+				}
+				components.rows[other_component_idx] = 0;
+			}
+			if (component_idx == -1)
+			{
+				component_idx = components.num_components++;
+				components.rows[component_idx] = 0;
+			}
+			component_of_row[row] = component_idx;
+			components.rows[component_idx] |= (uint32_t)1 << row;
+		}
+
+		// drop components emptied by merging
+		int num_components = 0;
+		for (int component_idx = 0; component_idx < components.num_components; ++component_idx)
+		{
+			if (components.rows[component_idx] != 0)
+				components.rows[num_components++] = components.rows[component_idx];
+		}
+		components.num_components = num_components;
+	}
+
+	bool are_rows_dependent(int row1, int row2, uint32_t const (&regions)[max_num_rows],
+			uint32_t const (&near_regions)[max_num_rows]) const
+	{
+		assert(row1 < row2);
+		if (row2 - row1 == 1)
+			return true;
+		if (regions[row1] & near_regions[row2] || regions[row2] & near_regions[row1])
+			return true;
+		if (row2 - row1 == 2)
+		{
+			// tiles in the row between them (which is processed) that can displace to both
+			int const middle_row = row1 + 1;
+			uint8_t const up_and_down = 1 << 0 | 1 << 2; // see orthogonal_dirs
+			for (Board::Tile const & tile : board.get_row_tiles(middle_row))
+			{
+				if ((tile.cells_for_displacement & up_and_down) == up_and_down
+						&& board.get_cell_value({middle_row, tile.col}) > 0)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// Solutions of each component found by solve_components() at a rec_level.
+	struct ComponentSolutions
+	{
+		std::vector<Board> boards[max_num_rows];
+	};
+
+	/*
+	 * If rows left to solve make independent components, solves each of them separately (instead of nesting their
+	 * searches) and reports combinations of their solutions, in which numbers are unique.
+	 * return value: false if there is a single component, which is left to the caller
+	 */
+	bool solve_components()
+	{
+		// Adjacent rows always depend on each other, so rows left to solve can only split into components when there is
+		// a processed row between them. That is cheap to check, and most nodes are such that it is not the case.
+		uint32_t unprocessed_rows = 0;
+		for (int row = 0; row < board.num_rows; ++row)
+		{
+			if (rows_to_solve >> row & 1 && !board.get_row_is_processed(row))
+				unprocessed_rows |= (uint32_t)1 << row;
+		}
+		uint32_t const lowest_row = unprocessed_rows & -unprocessed_rows;
+		if (((unprocessed_rows + lowest_row) & unprocessed_rows) == 0)
+			return false;
+
+		Components components;
+		find_components(components);
+		if (components.num_components <= 1)
+			return false;
+
+		DBG(std::cout << __func__
+			<< " rec_level: " << rec_level
+			<< " num_components: " << components.num_components << std::endl);
+
+		while ((int)component_solutions.size() <= rec_level)
+			component_solutions.emplace_back(new ComponentSolutions());
+		ComponentSolutions & solutions = *component_solutions[rec_level];
+
+		uint32_t const orig_rows_to_solve = rows_to_solve;
+		std::vector<Board> * const orig_solutions_output = solutions_output;
+		bool has_solutions = true;
+		for (int component_idx = 0; component_idx < components.num_components && has_solutions && !is_stopped;
+				++component_idx)
+		{
+			solutions.boards[component_idx].clear();
+			rows_to_solve = components.rows[component_idx];
+			solutions_output = &solutions.boards[component_idx];
+			// this board is processed by the caller, so it is not looked up in processed_boards again
+			solve_best_row();
+			has_solutions = !solutions.boards[component_idx].empty();
+		}
+		rows_to_solve = orig_rows_to_solve;
+		solutions_output = orig_solutions_output;
+
+		if (has_solutions && !is_stopped)
+		{
+			Board const base(board);
+			combine_component_solutions(solutions, components.num_components, base, 0);
+		}
+		return true;
+	}
+
+	// Reports combinations of solutions of components from component_idx on, applied to the board.
+	void combine_component_solutions(ComponentSolutions const & solutions, int num_components, Board const & base,
+			int component_idx)
+	{
+		if (component_idx == num_components)
+		{
+			report_solution();
+			return;
+		}
+		for (Board const & solution : solutions.boards[component_idx])
+		{
+			// numbers of the component are the ones added to numbers of base
+			int const numbers_mark = board.numbers_in_grid.size();
+			bool is_ok = true;
+			for (auto it = solution.numbers_in_grid.begin() + base.numbers_in_grid.size();
+					it != solution.numbers_in_grid.end() && is_ok; ++it)
+				is_ok = board.numbers_in_grid.insert(*it);
+			if (is_ok)
+			{
+				board.toggle_changes(base, solution);
+				combine_component_solutions(solutions, num_components, base, component_idx + 1);
+				board.toggle_changes(base, solution);
+			}
+			board.numbers_in_grid.rollback(numbers_mark);
+		}
+	}
+
+	// true if checking degree of current_row is expected to cost too much compared to the subtree of best_row, see
+	// SearchConfig::use_impacts
+	bool is_check_skipped(int current_row, int best_row, uint32_t best_row_degree) const
+	{
+		if (!config.use_impacts || best_row == -1)
+			return false;
+		RowImpact const & best_impact = row_knowledge.row_impacts[rec_level][best_row];
+		double const probe_steps = row_knowledge.row_impacts[rec_level][current_row].probe_steps;
+		// even a check costing only a part of the best row's subtree rarely pays off, as a row with no completions is
+		// usually found again (and more cheaply) deeper in the subtree
+		return best_impact.branch_steps >= 0
+			&& probe_steps * max_probe_cost_ratio > best_row_degree * best_impact.branch_steps;
+	}
+
+	// Sets best_row to the first row in rows_to_check with the lowest degree, and best_row_degree to that degree.
+	// They are left unchanged if rows_to_check is empty.
+	// Completions of best_row are recorded in best_completions[rec_level]. Completions of rows which were fully
+	// enumerated are stored in completions_cache, and taken from there when the neighborhood of a row comes back.
+	void find_best_row(RowsToCheck const & rows_to_check, int & best_row,
+			uint32_t & best_row_degree)
+	{
+		while ((int)best_completions.size() <= rec_level)
+		{
+			best_completions.emplace_back(new RowCompletions());
+			candidate_completions.emplace_back(new RowCompletions());
+		}
+		best_completions[rec_level]->clear();
+
+		int num_probed_rows = 0;
+		for (auto const & p : rows_to_check)
+		{
+			int const current_row = p.second;
+
+			if (is_check_skipped(current_row, best_row, best_row_degree))
+			{
+				DBG2(std::cout << __func__
+					<< " rec_level: " << rec_level
+					<< " skipping current_row: " << current_row
+					<< " expected steps: " << row_knowledge.row_impacts[rec_level][current_row].probe_steps
+					<< " best_row_degree: " << best_row_degree
+					<< " best_row: " << best_row
+					<< std::endl);
+				continue;
+			}
+
+			DBG2(std::cout << __func__
+				<< " rec_level: " << rec_level
+				<< " start checking degree of current_row: " << current_row
+				<< " best_row_degree: " << best_row_degree
+				<< " best_row: " << best_row
+				<< std::endl);
+
+			uint32_t current_row_degree = 0;
+			RowCompletions & completions = *candidate_completions[rec_level];
+			completions.begin(board, current_row);
+			uint64_t const neighborhood_key = board.compute_row_neighborhood_key(current_row);
+			if (nogoods.contains(neighborhood_key))
+			{
+				DBG2(std::cout << __func__
+					<< " rec_level: " << rec_level
+					<< " current_row: " << current_row << " is a nogood" << std::endl);
+			}
+			else if (row_knowledge.completions_cache.find(neighborhood_key, completions))
+			{
+				for (int idx = 0; idx < completions.size() && current_row_degree < best_row_degree; ++idx)
+				{
+					if (completions.has_new_numbers(board, idx))
+						++current_row_degree;
+				}
+
+				DBG2(std::cout << __func__
+					<< " rec_level: " << rec_level
+					<< " current_row: " << current_row << " has cached completions: " << completions.size()
+					<< std::endl);
+			}
+			else
+			{
+				bool is_cut_off = false;
+				RowProcessor work(board, current_row, [&]()
+				{
+					++current_row_degree;
+					completions.capture(board);
+
+					DBG2(std::cout << "[degree testing callback]"
+						<< " rec_level: " << rec_level
+						<< " degree of current_row: " << current_row << " is at the moment: " << current_row_degree
+						<< " best_row_degree: " << best_row_degree
+						<< " best_row: " << best_row
+						<< std::endl);
+					DBG3(std::cout << board << std::endl);
+
+					is_cut_off = current_row_degree >= best_row_degree;
+					return !is_cut_off;
+				});
+				work.run();
+				num_steps += work.get_num_steps();
+				update_average(row_knowledge.row_impacts[rec_level][current_row].probe_steps,
+						(double)work.get_num_steps());
+				if (!work.get_has_rejected_duplicate())
+				{
+					if (current_row_degree == 0)
+						nogoods.insert(neighborhood_key);
+					else if (!is_cut_off && completions.is_complete())
+						row_knowledge.completions_cache.insert(neighborhood_key, completions);
+				}
+			}
+
+			if (current_row_degree < best_row_degree)
+			{
+				best_row_degree = current_row_degree;
+				best_row = current_row;
+				best_completions[rec_level].swap(candidate_completions[rec_level]);
+			}
+
+			DBG(std::cout << __func__
+				<< " rec_level: " << rec_level
+				<< " found degree of current_row: " << current_row << " to be: " << current_row_degree
+				<< " best_row_degree: " << best_row_degree
+				<< " best_row: " << best_row
+				<< std::endl);
+
+			if (best_row_degree == 0 || ++num_probed_rows == config.max_probed_rows)
+				break;
+		}
+	}
+
+	// Same as find_best_row(), but rows are checked concurrently by probe_team, each thread with its own copy of the
+	// board and its own probe_completions. Checking a row stops as soon as its degree reaches the best one found by any
+	// thread. Among rows with the lowest degree, the first one to be fully checked is chosen (which may not be the first
+	// one in rows_to_check). Learned costs and completions_cache are shared by the threads, under a mutex.
+	void find_best_row_parallel(RowsToCheck const & rows_to_check, int & best_row,
+			uint32_t & best_row_degree)
+	{
+		while ((int)best_completions.size() <= rec_level)
+		{
+			best_completions.emplace_back(new RowCompletions());
+			candidate_completions.emplace_back(new RowCompletions());
+		}
+		best_completions[rec_level]->clear();
+		while ((int)probe_completions.size() < probe_team->get_num_threads())
+			probe_completions.emplace_back(new RowCompletions());
+
+		std::atomic<int> next_idx(0);
+		std::atomic<uint32_t> shared_best_row_degree(best_row_degree);
+		// for best_row, best_row_degree, best_completions, row_knowledge and num_steps
+		std::mutex mutex;
+
+		probe_team->run([&](int thread_idx)
+		{
+			Board probe_board(board);
+			for (int idx = next_idx++; idx < rows_to_check.num_rows && shared_best_row_degree > 0; idx = next_idx++)
+			{
+				int const current_row = rows_to_check.rows[idx].second;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (is_check_skipped(current_row, best_row, best_row_degree))
+						continue;
+				}
+
+				uint32_t current_row_degree = 0;
+				bool is_cut_off = false;
+				RowCompletions & completions = *probe_completions[thread_idx];
+				completions.begin(probe_board, current_row);
+				uint64_t const neighborhood_key = probe_board.compute_row_neighborhood_key(current_row);
+				bool const is_nogood = nogoods.contains(neighborhood_key);
+				bool is_cached = false;
+				if (!is_nogood)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					is_cached = row_knowledge.completions_cache.find(neighborhood_key, completions);
+				}
+				if (is_cached)
+				{
+					for (int completion_idx = 0; completion_idx < completions.size() && !is_cut_off; ++completion_idx)
+					{
+						if (completions.has_new_numbers(probe_board, completion_idx))
+							++current_row_degree;
+						is_cut_off = current_row_degree >= shared_best_row_degree.load(std::memory_order_relaxed);
+					}
+				}
+				else if (!is_nogood)
+				{
+					RowProcessor work(probe_board, current_row, [&]()
+					{
+						++current_row_degree;
+						completions.capture(probe_board);
+						is_cut_off = current_row_degree >= shared_best_row_degree.load(std::memory_order_relaxed);
+						return !is_cut_off;
+					});
+					work.run();
+
+					std::lock_guard<std::mutex> lock(mutex);
+					num_steps += work.get_num_steps();
+					update_average(row_knowledge.row_impacts[rec_level][current_row].probe_steps,
+							(double)work.get_num_steps());
+					if (!work.get_has_rejected_duplicate())
+					{
+						if (current_row_degree == 0)
+							nogoods.insert(neighborhood_key);
+						else if (!is_cut_off && completions.is_complete())
+							row_knowledge.completions_cache.insert(neighborhood_key, completions);
+					}
+				}
+
+				if (!is_cut_off)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (current_row_degree < best_row_degree)
+					{
+						best_row_degree = current_row_degree;
+						best_row = current_row;
+						shared_best_row_degree = current_row_degree;
+						best_completions[rec_level].swap(probe_completions[thread_idx]);
+					}
+				}
+
+				DBG(std::cout << "find_best_row_parallel"
+					<< " rec_level: " << rec_level
+					<< " found degree of current_row: " << current_row << " to be: " << current_row_degree
+					<< (is_cut_off ? " (at least)" : "")
+					<< std::endl);
+			}
+		});
+	}
+
+	Board & board;
+	Callback const callback;
+	SearchConfig const config;
+	int rec_level;
+	std::unique_ptr<ProcessedBoards> own_processed_boards;
+	ProcessedBoards & processed_boards;
+	std::unique_ptr<NogoodStore> own_nogoods;
+	NogoodStore & nogoods;
+	int const split_rec_level;
+	SplitCallback const split_callback;
+	std::unique_ptr<ThreadTeam> probe_team;
+	// per rec_level, completions of best row found by find_best_row() and of the row being checked
+	std::vector<std::unique_ptr<RowCompletions>> best_completions;
+	std::vector<std::unique_ptr<RowCompletions>> candidate_completions;
+	// per thread of probe_team, completions of the row it checks
+	std::vector<std::unique_ptr<RowCompletions>> probe_completions;
+	std::unique_ptr<RowKnowledge> own_row_knowledge;
+	RowKnowledge & row_knowledge;
+	// rows solved by rec_solve(), a component of rows when solving it separately
+	uint32_t rows_to_solve;
+	// where solutions of a component are collected, nullptr when they are passed to callback
+	std::vector<Board> * solutions_output;
+	// per rec_level, see solve_components()
+	std::vector<std::unique_ptr<ComponentSolutions>> component_solutions;
+	std::mt19937_64 rng; // for SearchConfig::seed
+	std::atomic<bool> const * cancel_flag;
+	uint64_t num_rec_solves; // since the search was (re)started
+	uint64_t max_rec_solves; // when the search is restarted, 0 for never
+	bool is_stopped; // see should_stop()
+	uint64_t num_steps; // RowProcessor steps of the sequential search
+	CheckpointCallback checkpoint_callback; // see set_checkpoint_callback()
+	std::chrono::steady_clock::duration checkpoint_interval;
+	std::chrono::steady_clock::time_point next_checkpoint_time;
+	SearchPosition position; // of the search, levels down to the first call of solve_components()
+	SearchPosition resume_position; // see set_resume_position()
+	int resume_length; // levels of resume_position not fast-forwarded to yet
+};
+
+/*
+ * Runs NumberCrossSolver on several threads. Branches of the first split_rec_level levels of recursion become tasks
+ * with their own copy of the board. Each worker thread pushes tasks it creates to its own deque and takes them from
+ * its back, and when it runs out of tasks it steals from the front of other workers' deques (where tasks of lower
+ * rec_level, so bigger ones, are). Workers share the table of processed boards, and each one keeps what it learned
+ * about rows (NumberCrossSolver::RowKnowledge) for all the tasks it runs.
+ */
+class ParallelNumberCrossSolver
+{
+public:
+	// Callback is called when grid is solved, with the solved board. Calls are serialized.
+	using Callback = NumberCrossSolver::Callback;
+
+	ParallelNumberCrossSolver(Board const & board, int num_threads, int split_rec_level, Callback const & callback):
+		board(board),
+		callback(callback),
+		num_threads(num_threads),
+		split_rec_level(split_rec_level),
+		callback_mutex(),
+		workers(num_threads),
+		processed_boards(),
+		nogoods(),
+		idle_mutex(),
+		idle_cond(),
+		num_pending_tasks(0)
+	{
+		assert(num_threads > 0);
+	}
+
+	void run()
+	{
+		push_task(0, {std::unique_ptr<Board>(new Board(board)), 0});
+
+		std::vector<std::thread> threads;
+		for (int worker_idx = 0; worker_idx < num_threads; ++worker_idx)
+			threads.emplace_back(&ParallelNumberCrossSolver::work, this, worker_idx);
+		for (std::thread & thread : threads)
+			thread.join();
+		assert(num_pending_tasks == 0);
+	}
+
+	TranspositionTable::Stats get_processed_boards_stats() const
+	{
+		return processed_boards.get_stats();
+	}
+
+	NogoodStore::Stats get_nogoods_stats() const
+	{
+		return nogoods.get_stats();
+	}
+
+private:
+	struct Task
+	{
+		std::unique_ptr<Board> board;
+		int rec_level;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		NumberCrossSolver::RowKnowledge row_knowledge; // kept for all tasks the worker runs
+	};
+
+	void push_task(int worker_idx, Task task)
+	{
+		++num_pending_tasks;
+		{
+			std::lock_guard<std::mutex> lock(workers[worker_idx].mutex);
+			workers[worker_idx].tasks.push_back(std::move(task));
+		}
+		std::lock_guard<std::mutex> lock(idle_mutex);
+		idle_cond.notify_one();
+	}
+
+	bool pop_task(int worker_idx, Task & task)
+	{
+		{
+			Worker & worker = workers[worker_idx];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			if (!worker.tasks.empty())
+			{
+				task = std::move(worker.tasks.back());
+				worker.tasks.pop_back();
+				return true;
+			}
+		}
+		for (int i = 1; i < num_threads; ++i)
+		{
+			Worker & victim = workers[(worker_idx + i) % num_threads];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty())
+			{
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work(int worker_idx)
+	{
+		auto const solved_callback = [this](Board const & solved_board)
+		{
+			std::lock_guard<std::mutex> lock(callback_mutex);
+			callback(solved_board);
+		};
+		// Branches of a task are pushed when it is done, the last one first, so that the worker takes them in the order
+		// of the sequential search. Learned costs of rows depend on that order, taking the last branch first was more
+		// than twice slower.
+		std::vector<Task> branch_tasks;
+		auto const split_callback = [&branch_tasks](Board const & branch_board, int rec_level)
+		{
+			branch_tasks.push_back({std::unique_ptr<Board>(new Board(branch_board)), rec_level});
+		};
+
+		while (true)
+		{
+			Task task;
+			if (pop_task(worker_idx, task))
+			{
+				NumberCrossSolver solver(*task.board, task.rec_level, solved_callback, processed_boards, nogoods,
+						workers[worker_idx].row_knowledge, split_rec_level, split_callback);
+				solver.run();
+				for (auto it = branch_tasks.rbegin(); it != branch_tasks.rend(); ++it)
+					push_task(worker_idx, std::move(*it));
+				branch_tasks.clear();
+				if (--num_pending_tasks == 0)
+				{
+					std::lock_guard<std::mutex> lock(idle_mutex);
+					idle_cond.notify_all();
+				}
+			}
+			else
+			{
+				// Wait for a new task, or for all tasks to be done. Tasks are only pushed by workers running a task,
+				// so when there are no pending ones, we are done.
+				std::unique_lock<std::mutex> lock(idle_mutex);
+				if (num_pending_tasks == 0)
+					return;
+				idle_cond.wait_for(lock, std::chrono::milliseconds(10));
+			}
+		}
+	}
+
+	Board const & board;
+	Callback const callback;
+	int const num_threads;
+	int const split_rec_level;
+
+	std::mutex callback_mutex;
+	std::vector<Worker> workers;
+	NumberCrossSolver::ProcessedBoards processed_boards;
+	NogoodStore nogoods;
+	std::mutex idle_mutex;
+	std::condition_variable idle_cond;
+	std::atomic<int> num_pending_tasks; // pushed and not yet finished
+};
+
+/*
+ * Runs differently configured NumberCrossSolvers on the same board, each one on its own thread with its own copy of
+ * the board and its own tables. The first one to finish the search wins, it has reported all solutions by then, and
+ * the other ones are cancelled. Solutions are reported by any solver which finds them, so the same solution may be
+ * reported by several solvers.
+ */
+class PortfolioSolver
+{
+public:
+	// Callback is called when grid is solved, with the solved board. Calls are serialized.
+	using Callback = NumberCrossSolver::Callback;
+
+	PortfolioSolver(Board const & board, std::vector<SearchConfig> const & configs, Callback const & callback):
+		board(board),
+		configs(configs),
+		callback(callback),
+		callback_mutex(),
+		cancel_flag(false),
+		winner(-1)
+	{
+		assert(!configs.empty());
+	}
+
+	// A few configurations which differ in each of SearchConfig's heuristics.
+	static std::vector<SearchConfig> get_default_configs()
+	{
+		std::vector<SearchConfig> configs(6);
+		configs[1].row_order = RowOrder::row_index;
+		configs[2].row_order = RowOrder::processed_neighbors;
+		configs[3].seed = 1;
+		configs[3].restart_rec_solves = 1 << 10;
+		configs[4].max_probed_rows = 3;
+		configs[4].memo_rec_level = 8;
+		configs[5].use_impacts = false;
+		return configs;
+	}
+
+	void run()
+	{
+		std::vector<std::thread> threads;
+		for (int config_idx = 0; config_idx < (int)configs.size(); ++config_idx)
+			threads.emplace_back(&PortfolioSolver::work, this, config_idx);
+		for (std::thread & thread : threads)
+			thread.join();
+		assert(winner != -1);
+	}
+
+	// return value: index of the configuration which finished first
+	int get_winner() const
+	{
+		return winner;
+	}
+
+private:
+	void work(int config_idx)
+	{
+		Board solver_board(board);
+		NumberCrossSolver solver(solver_board, [this](Board const & solved_board)
+		{
+			std::lock_guard<std::mutex> lock(callback_mutex);
+			callback(solved_board);
+		}, 1, configs[config_idx]);
+		solver.set_cancel_flag(&cancel_flag);
+		if (solver.run())
+		{
+			// the other ones may have finished at the same time
+			int expected = -1;
+			if (winner.compare_exchange_strong(expected, config_idx))
+				cancel_flag = true;
+		}
+	}
+
+	Board const & board;
+	std::vector<SearchConfig> const configs;
+	Callback const callback;
+	std::mutex callback_mutex;
+	std::atomic<bool> cancel_flag;
+	std::atomic<int> winner;
+};
+
+/*
+ * Alternative engine, which first enumerates colorings of regions (values of all regions, such that neighboring regions
+ * have different values allowed by hints) and then solves tiles and displacements of each coloring by NumberCrossSolver.
+ *
+ * Colorings are pruned while they are enumerated: once all regions of the window of a row (rows in [row-1; row+1],
+ * whose regions are assigned and tiles placed by RowProcessor) have values, the row is processed on a board with values
+ * only in these regions. This relaxes constraints of the full board (cells of other rows may take any value), so a row
+ * without completions rules out the coloring, and so does a number which is in every completion of two rows. Results
+ * depend only on values of regions of the window, they are cached under them and reused by colorings with the same
+ * window.
+ */
+class RegionFirstSolver
+{
+public:
+	// Callback is called when grid is solved, with the solved board.
+	using Callback = NumberCrossSolver::Callback;
+
+	struct Stats
+	{
+		uint64_t colorings; // colorings solved by NumberCrossSolver
+		uint64_t rejected; // partial colorings ruled out by checks of rows
+		uint64_t row_checks;
+		uint64_t row_check_hits; // checks of rows found in the cache
+	};
+
+	// The board must not have any values yet.
+	RegionFirstSolver(Board & board, Callback const & callback):
+		board(board),
+		callback(callback),
+		empty_board(board),
+		processed_boards(),
+		nogoods(),
+		row_knowledge(),
+		window_regions(),
+		row_checks(),
+		checked_rows(0),
+		forced_numbers(),
+		stats()
+	{
+		for (int row = 0; row < board.num_rows; ++row)
+		{
+			for (int window_row = std::max(row - 1, 0); window_row <= std::min(row + 1, board.num_rows - 1); ++window_row)
+			{
+				for (int col = 0; col < board.num_cols; ++col)
+					window_regions[row] |= (uint32_t)1 << board.get_cell_region({window_row, col});
+			}
+		}
+	}
+
+	void run()
+	{
+		assign_regions(0);
+	}
+
+	Stats const & get_stats() const
+	{
+		return stats;
+	}
+
+	TranspositionTable::Stats get_processed_boards_stats() const
+	{
+		return processed_boards.get_stats();
+	}
+
+	NogoodStore::Stats get_nogoods_stats() const
+	{
+		return nogoods.get_stats();
+	}
+
+private:
+	// Result of processing a row on a board with values only in regions of its window.
+	struct RowCheck
+	{
+		bool has_completions;
+		std::vector<Number> forced_numbers; // numbers in every completion
+	};
+
+	// Assigns values to regions of rows from row on, with the same enumeration as RowProcessor uses.
+	// return value: true if visiting should be continued
+	bool assign_regions(int const row)
+	{
+		if (row == board.num_rows)
+		{
+			solve_coloring();
+			return true;
+		}
+		AssignRowRegionsValue work(board, row, [this, row]() { return done_row_regions(row); });
+		return work.run();
+	}
+
+	bool done_row_regions(int const row)
+	{
+		uint32_t regions_with_value = 0;
+		for (int region_idx = 0; region_idx < board.get_num_regions(); ++region_idx)
+		{
+			if (board.get_region_value(region_idx) != -1)
+				regions_with_value |= (uint32_t)1 << region_idx;
+		}
+
+		// check rows whose windows got all their values
+		uint32_t const orig_checked_rows = checked_rows;
+		int const numbers_mark = forced_numbers.size();
+		bool is_ok = true;
+		for (int window_row = 0; window_row < board.num_rows && is_ok; ++window_row)
+		{
+			if (checked_rows >> window_row & 1 || window_regions[window_row] & ~regions_with_value)
+				continue;
+			checked_rows |= (uint32_t)1 << window_row;
+			RowCheck const & row_check = check_row(window_row);
+			is_ok = row_check.has_completions;
+			for (auto it = row_check.forced_numbers.begin(); it != row_check.forced_numbers.end() && is_ok; ++it)
+				is_ok = forced_numbers.insert(*it);
+		}
+
+		bool visit_more = true;
+		if (is_ok)
+			visit_more = assign_regions(row + 1);
+		else
+			++stats.rejected;
+		forced_numbers.rollback(numbers_mark);
+		checked_rows = orig_checked_rows;
+		return visit_more;
+	}
+
+	RowCheck const & check_row(int const row)
+	{
+		// values of regions of the window, 4 bits each
+		uint64_t window_key = 0;
+		for (uint32_t rest = window_regions[row]; rest != 0; rest &= rest - 1)
+			window_key = window_key << 4 | board.get_region_value(__builtin_ctz(rest));
+		++stats.row_checks;
+		auto const it = row_checks[row].find(window_key);
+		if (it != row_checks[row].end())
+		{
+			++stats.row_check_hits;
+			return it->second;
+		}
+
+		Board window_board(empty_board);
+		for (uint32_t rest = window_regions[row]; rest != 0; rest &= rest - 1)
+		{
+			int const region_idx = __builtin_ctz(rest);
+			window_board.set_region_value(region_idx, board.get_region_value(region_idx));
+		}
+		RowCheck & row_check = row_checks[row][window_key];
+		row_check.has_completions = false;
+		RowProcessor work(window_board, row, [&]()
+		{
+			Number numbers[max_num_cols];
+			int num_numbers = 0;
+			window_board.for_each_row_number(row, [&](Number number) { numbers[num_numbers++] = number; });
+			std::vector<Number> & forced = row_check.forced_numbers;
+			if (!row_check.has_completions)
+			{
+				row_check.has_completions = true;
+				forced.assign(&numbers[0], &numbers[num_numbers]);
+			}
+			else
+			{
+				forced.erase(std::remove_if(forced.begin(), forced.end(), [&](Number number)
+						{ return std::find(&numbers[0], &numbers[num_numbers], number) == &numbers[num_numbers]; }),
+					forced.end());
+			}
+			// nothing more to learn from other completions
+			return !forced.empty();
+		});
+		work.run();
+		return row_check;
+	}
+
+	void solve_coloring()
+	{
+		++stats.colorings;
+		DBG(std::cout << __func__ << " coloring: " << stats.colorings << std::endl);
+		NumberCrossSolver solver(board, 0, callback, processed_boards, nogoods, row_knowledge, 0,
+				NumberCrossSolver::SplitCallback());
+		solver.run();
+	}
+
+	Board & board;
+	Callback const callback;
+	Board const empty_board;
+	// shared by solvers of all colorings, their keys include values of regions
+	NumberCrossSolver::ProcessedBoards processed_boards;
+	NogoodStore nogoods;
+	NumberCrossSolver::RowKnowledge row_knowledge;
+	uint32_t window_regions[max_num_rows]; // regions of rows in [row-1; row+1], i'th bit is for region i
+	std::unordered_map<uint64_t, RowCheck> row_checks[max_num_rows]; // keyed by values of regions of the window
+	uint32_t checked_rows; // rows whose windows have values and passed check_row(), i'th bit is for row i
+	NumberSet<Board::max_num_numbers> forced_numbers; // forced numbers of checked rows
+	Stats stats;
+};
+
+std::ostream & operator<<(std::ostream & out, RegionFirstSolver::Stats const & stats)
+{
+	return out << "colorings: " << stats.colorings
+		<< " rejected: " << stats.rejected
+		<< " row checks: " << stats.row_checks
+		<< " hits: " << stats.row_check_hits;
+}
+
+// FNV-1a, to tell whether a checkpoint was saved for the same input.
+uint64_t hash_text(std::string const & text)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (char const c : text)
+		hash = (hash ^ (unsigned char)c) * 0x100000001b3;
+	return hash;
+}
+
+/*
+ * What is needed to resume a search: its position and solutions found so far, for the input with the given hash.
+ * Solutions are kept both as search states of their boards, to recognize the ones found again after resuming, and as
+ * they were printed. Memo of the solver is much bigger, it is saved to a separate file.
+ */
+struct Checkpoint
+{
+	static constexpr uint32_t magic = 0x5043434e; // "NCCP"
+	static constexpr uint32_t version = 2; // 2: build_num_cols after version
+	// search states of the wide build are laid out differently, its checkpoints are not read by the other build
+	static constexpr uint32_t build_num_cols = max_num_cols;
+
+	uint64_t input_hash = 0;
+	SearchPosition position;
+	std::vector<Board> solutions;
+	std::vector<std::string> printed_solutions;
+
+	void write(std::ostream & out) const
+	{
+		write_value(out, magic);
+		write_value(out, version);
+		write_value(out, build_num_cols);
+		write_value(out, input_hash);
+		write_value(out, position.path_length);
+		for (int rec_level = 0; rec_level < position.path_length; ++rec_level)
+			write_value(out, position.path[rec_level]);
+		write_value(out, (uint32_t)solutions.size());
+		for (int idx = 0; idx < (int)solutions.size(); ++idx)
+		{
+			solutions[idx].write_state(out);
+			write_value(out, (uint32_t)printed_solutions[idx].size());
+			out.write(printed_solutions[idx].data(), printed_solutions[idx].size());
+		}
+	}
+
+	// Reads a checkpoint written for the same input_hash, solutions are read into copies of the board.
+	// return value: false if it could not be read
+	bool read(std::istream & in, Board const & board)
+	{
+		uint32_t read_magic, read_version, read_build_num_cols, num_solutions;
+		uint64_t read_input_hash;
+		if (!read_value(in, read_magic) || read_magic != magic
+				|| !read_value(in, read_version) || read_version != version
+				|| !read_value(in, read_build_num_cols) || read_build_num_cols != build_num_cols
+				|| !read_value(in, read_input_hash) || read_input_hash != input_hash)
+			return false;
+		if (!read_value(in, position.path_length) || position.path_length < 0 || position.path_length > board.num_rows)
+			return false;
+		for (int rec_level = 0; rec_level < position.path_length; ++rec_level)
+		{
+			int const row = read_value(in, position.path[rec_level]) ? position.path[rec_level].row : -1;
+			if (row < 0 || row >= board.num_rows)
+				return false;
+		}
+		if (!read_value(in, num_solutions))
+			return false;
+		for (uint32_t idx = 0; idx < num_solutions; ++idx)
+		{
+			Board solution(board);
+			uint32_t printed_size;
+			if (!solution.read_state(in) || !read_value(in, printed_size) || printed_size > (1 << 16))
+				return false;
+			std::string printed(printed_size, '\0');
+			if (!in.read(&printed[0], printed_size))
+				return false;
+			solutions.push_back(solution);
+			printed_solutions.push_back(printed);
+		}
+		return true;
+	}
+};
+
+// Writes a file through a temporary one, which replaces it only when it is written completely, so that the previous
+// file is left if the process is killed while writing it.
+// return value: false if it could not be written
+bool write_file(std::string const & file_name, std::function<void(std::ostream &)> const & write)
+{
+	std::string const tmp_file_name = file_name + ".tmp";
+	{
+		std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+		write(out);
+		if (!out.flush())
+			return false;
+	}
+	return std::rename(tmp_file_name.c_str(), file_name.c_str()) == 0;
+}
+
+// Set on SIGTERM, to save a checkpoint and stop.
+std::atomic<bool> is_terminating(false);
+static_assert(std::atomic<bool>::is_always_lock_free, "is_terminating is set by a signal handler");
+
+extern "C" void handle_sigterm(int)
+{
+	is_terminating.store(true, std::memory_order_relaxed);
+}
+
+int main(int argc, char * argv[])
+{
+	int num_threads = 1;
+	int split_rec_level = 2;
+	int probe_threads = 1;
+	bool is_region_first = false;
+	bool is_portfolio = false;
+	std::string checkpoint_file_name;
+	int checkpoint_interval = 600;
+	bool is_memo_checkpointed = false;
+	std::string resume_file_name;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg.rfind("--threads=", 0) == 0 && std::atoi(arg.c_str() + 10) > 0)
+		{
+			num_threads = std::atoi(arg.c_str() + 10);
+		}
+		else if (arg.rfind("--split-depth=", 0) == 0 && std::atoi(arg.c_str() + 14) > 0)
+		{
+			split_rec_level = std::atoi(arg.c_str() + 14);
+		}
+		else if (arg.rfind("--probe-threads=", 0) == 0 && std::atoi(arg.c_str() + 16) > 0)
+		{
+			probe_threads = std::atoi(arg.c_str() + 16);
+		}
+		else if (arg == "--engine=rows" || arg == "--engine=regions")
+		{
+			is_region_first = arg == "--engine=regions";
+		}
+		else if (arg == "--portfolio")
+		{
+			is_portfolio = true;
+		}
+		else if (arg.rfind("--checkpoint=", 0) == 0 && arg.size() > 13)
+		{
+			checkpoint_file_name = arg.substr(13);
+		}
+		else if (arg.rfind("--checkpoint-interval=", 0) == 0 && std::atoi(arg.c_str() + 22) > 0)
+		{
+			checkpoint_interval = std::atoi(arg.c_str() + 22);
+		}
+		else if (arg == "--checkpoint-memo")
+		{
+			is_memo_checkpointed = true;
+		}
+		else if (arg.rfind("--resume=", 0) == 0 && arg.size() > 9)
+		{
+			resume_file_name = arg.substr(9);
+		}
+		else
+		{
+			std::cerr << "usage: " << argv[0]
+				<< " [--engine=rows|regions] [--threads=N [--split-depth=D] | --probe-threads=N | --portfolio]"
+				<< " [--checkpoint=FILE [--checkpoint-interval=SECONDS] [--checkpoint-memo]] [--resume=FILE]\n";
+			return 1;
+		}
+	}
+	if (num_threads > 1 && probe_threads > 1)
+	{
+		std::cerr << "--threads and --probe-threads cannot be used together\n";
+		return 1;
+	}
+	if (is_portfolio && (num_threads > 1 || probe_threads > 1))
+	{
+		std::cerr << "--portfolio cannot be used with --threads or --probe-threads\n";
+		return 1;
+	}
+	if (is_region_first && (num_threads > 1 || probe_threads > 1 || is_portfolio))
+	{
+		std::cerr << "--engine=regions is single-threaded\n";
+		return 1;
+	}
+	if ((!checkpoint_file_name.empty() || !resume_file_name.empty())
+			&& (is_region_first || is_portfolio || num_threads > 1))
+	{
+		std::cerr << "--checkpoint and --resume cannot be used with --engine=regions, --portfolio or --threads\n";
+		return 1;
+	}
+	if (is_memo_checkpointed && checkpoint_file_name.empty())
+	{
+		std::cerr << "--checkpoint-memo needs --checkpoint\n";
+		return 1;
+	}
+
+#ifndef NDEBUG
+	std::cout << "Running in debug config" << std::endl;
+#else
+	std::cout << "Running in release config" << std::endl;
+#endif
+
+	std::string const input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+	std::istringstream input_stream(input);
+	Board board = read_data(input_stream);
+	board.compute_region_neighbors();
+	board.compute_tile_patterns();
 	print_regions_neighbors(board);
 
-	NumberCrossSolver solver(board, [&]()
+	// Solutions found so far, also the ones found before the search was resumed (they are printed again).
+	Checkpoint checkpoint;
+	checkpoint.input_hash = hash_text(input);
+	if (!resume_file_name.empty())
 	{
-		std::cout << "Found solution:\n" << board << std::endl;
-	});
+		std::ifstream in(resume_file_name, std::ios::binary);
+		if (!checkpoint.read(in, board))
+		{
+			std::cerr << "cannot resume from " << resume_file_name << ", it is not a checkpoint of this board\n";
+			return 1;
+		}
+		for (std::string const & printed_solution : checkpoint.printed_solutions)
+			std::cout << "Found solution:\n" << printed_solution << std::endl;
+	}
+
+	// Displacements along longer cycles of tiles and cells can still give the same grid, it is reported once. Solutions
+	// are looked up by their keys, the boards are compared only when the keys are equal.
+	std::unordered_multimap<uint64_t, int> solution_idx_by_key;
+	for (int idx = 0; idx < (int)checkpoint.solutions.size(); ++idx)
+		solution_idx_by_key.emplace(checkpoint.solutions[idx].get_key(), idx);
+	auto const callback = [&checkpoint, &solution_idx_by_key](Board const & solved_board)
+	{
+		std::lock_guard<std::mutex> lock(output_mutex);
+		uint64_t const key = solved_board.get_key();
+		auto const range = solution_idx_by_key.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (checkpoint.solutions[it->second] == solved_board)
+				return;
+		}
+		std::ostringstream printed_solution;
+		printed_solution << solved_board;
+		solution_idx_by_key.emplace(key, (int)checkpoint.solutions.size());
+		checkpoint.solutions.push_back(solved_board);
+		checkpoint.printed_solutions.push_back(printed_solution.str());
+		std::cout << "Found solution:\n" << checkpoint.printed_solutions.back() << std::endl;
+	};
 	std::cout << "Solving..." << std::endl;
-	solver.run();
+#ifndef NDEBUG
+	uint64_t const num_heap_allocations_before = num_heap_allocations;
+#endif
+	if (is_region_first)
+	{
+		RegionFirstSolver solver(board, callback);
+		solver.run();
+		std::cout << "Region " << solver.get_stats() << std::endl;
+		std::cout << "Processed boards " << solver.get_processed_boards_stats() << std::endl;
+		std::cout << "Nogoods " << solver.get_nogoods_stats() << std::endl;
+	}
+	else if (is_portfolio)
+	{
+		std::vector<SearchConfig> const configs = PortfolioSolver::get_default_configs();
+		PortfolioSolver solver(board, configs, callback);
+		auto const start_time = std::chrono::steady_clock::now();
+		solver.run();
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start_time;
+		std::cout << "Portfolio winner: " << solver.get_winner() << " (" << configs[solver.get_winner()] << ") after "
+			<< elapsed.count() << "s" << std::endl;
+	}
+	else if (num_threads > 1)
+	{
+		ParallelNumberCrossSolver solver(board, num_threads, split_rec_level, callback);
+		solver.run();
+		std::cout << "Processed boards " << solver.get_processed_boards_stats() << std::endl;
+		std::cout << "Nogoods " << solver.get_nogoods_stats() << std::endl;
+	}
+	else
+	{
+		NumberCrossSolver solver(board, callback, probe_threads);
+		if (!resume_file_name.empty())
+		{
+			solver.set_resume_position(checkpoint.position);
+			// the memo is optional
+			std::ifstream memo_in(resume_file_name + ".memo", std::ios::binary);
+			if (memo_in && !solver.load_memo(memo_in))
+			{
+				std::cerr << "cannot read " << resume_file_name << ".memo\n";
+				return 1;
+			}
+		}
+		if (!checkpoint_file_name.empty())
+		{
+			solver.set_checkpoint_callback([&](SearchPosition const & position)
+			{
+				std::lock_guard<std::mutex> lock(output_mutex);
+				checkpoint.position = position;
+				// the memo is written after the position, so that it never has boards whose solutions are not saved
+				bool const is_saved = write_file(checkpoint_file_name, [&checkpoint](std::ostream & out)
+				{
+					checkpoint.write(out);
+				}) && (!is_memo_checkpointed || write_file(checkpoint_file_name + ".memo", [&solver](std::ostream & out)
+				{
+					solver.save_memo(out);
+				}));
+				if (!is_saved)
+					std::cerr << "cannot save checkpoint to " << checkpoint_file_name << "\n";
+			}, std::chrono::seconds(checkpoint_interval));
+			solver.set_cancel_flag(&is_terminating);
+			std::signal(SIGTERM, handle_sigterm);
+		}
+		bool const is_finished = solver.run();
+		std::cout << "Processed boards " << solver.get_processed_boards_stats() << std::endl;
+		std::cout << "Nogoods " << solver.get_nogoods_stats() << std::endl;
+		std::cout << "Row completions cache " << solver.get_completions_cache_stats() << std::endl;
+		if (!is_finished)
+		{
+			std::cout << "Search stopped, resume it with --resume=" << checkpoint_file_name << std::endl;
+			return 1;
+		}
+	}
+#ifndef NDEBUG
+	std::cout << "Heap allocations during search: " << num_heap_allocations - num_heap_allocations_before << std::endl;
+#endif
 }